@@ -0,0 +1,148 @@
+// Measures the throughput of the front end over the input files. Built as the cx-benchmark executable, separately from the
+// compiler, and run over the standard library and a large synthetic file by scripts/benchmark-lexer.py.
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+#pragma warning(push, 0)
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/raw_ostream.h>
+#pragma warning(pop)
+#include "../src/ast/module.h"
+#include "../src/ast/source-manager.h"
+#include "../src/driver/driver.h"
+#include "../src/parser/lex.h"
+#include "../src/parser/parse.h"
+#include "../src/support/utility.h"
+
+using namespace cx;
+namespace cl = llvm::cl;
+
+// The compiler's diagnostics depend on these, which the compiler driver defines for the cx executable.
+namespace cx {
+std::atomic<int> errors(0);
+cl::opt<WarningMode> warningMode(cl::desc("Warning mode:"), cl::values(clEnumValN(WarningMode::Suppress, "w", "Suppress all warnings"),
+                                                                      clEnumValN(WarningMode::TreatAsErrors, "Werror", "Treat warnings as errors")));
+} // namespace cx
+
+static cl::list<std::string> inputs(cl::Positional, cl::desc("<input files>"), cl::OneOrMore);
+static cl::opt<unsigned> iterations("iterations", cl::desc("Run each benchmark N times instead of for at least a second"), cl::value_desc("N"));
+
+/// Runs the iteration until at least the given number of seconds has passed, or for the number of -iterations, stopping early
+/// if it reports errors. Returns the number of iterations run and the elapsed time in seconds.
+template<typename Iteration>
+static std::pair<uint64_t, double> repeat(double seconds, Iteration&& iteration) {
+    uint64_t count = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed;
+
+    do {
+        iteration();
+        count++;
+        elapsed = std::chrono::steady_clock::now() - startTime;
+    } while ((iterations ? count < iterations : elapsed.count() < seconds) && !errors);
+
+    return { count, elapsed.count() };
+}
+
+/// Lexes the given files over and over, and prints the throughput of the lexer.
+static void runLexerBenchmark(llvm::ArrayRef<FileID> files, uint64_t bytesPerIteration) {
+    uint64_t tokens = 0;
+    auto [count, seconds] = repeat(1.0, [&] {
+        for (auto file : files) {
+            Lexer lexer(file);
+            while (lexer.nextToken() != Token::None) {
+                tokens++;
+            }
+        }
+    });
+
+    double megabytes = double(bytesPerIteration) * double(count) / (1024 * 1024);
+    llvm::outs() << llvm::format("lexed %zu files (%.2f MB, %llu tokens) %llu times in %.3f s: %.1f MB/s, %.1f million tokens/s\n", files.size(),
+                                 bytesPerIteration / (1024.0 * 1024.0), (unsigned long long) (tokens / count), (unsigned long long) count, seconds,
+                                 megabytes / seconds, tokens / seconds / 1e6);
+}
+
+// Stores the results of benchmarked computations so that they can't be optimized away.
+static volatile uint64_t checksumSink;
+
+/// Classifies the identifiers and keywords in the given files with getKeywordKind() and with the StringMap lookup it replaced,
+/// and prints the average time per lookup of both.
+static void runKeywordLookupBenchmark(llvm::ArrayRef<FileID> files) {
+    std::vector<llvm::StringRef> words;
+    for (auto file : files) {
+        Lexer lexer(file);
+        for (Token token = lexer.nextToken(); token != Token::None; token = lexer.nextToken()) {
+            if (token == Token::Identifier || (token >= Token::Addressof && token <= Token::HashEndif)) {
+                words.push_back(token.getString());
+            }
+        }
+    }
+    if (words.empty()) return;
+
+    llvm::StringMap<Token::Kind> keywordMap;
+    for (int kind = Token::Addressof; kind <= Token::HashEndif; ++kind) {
+        keywordMap.try_emplace(toString(Token::Kind(kind)), Token::Kind(kind));
+    }
+
+    auto measure = [&](auto&& lookup) {
+        uint64_t checksum = 0;
+        auto [count, seconds] = repeat(0.5, [&] {
+            for (auto word : words) {
+                checksum += lookup(word);
+            }
+        });
+        checksumSink = checksum;
+        return seconds * 1e9 / (count * words.size());
+    };
+
+    auto perfectHashTime = measure([](llvm::StringRef word) { return getKeywordKind(word); });
+    auto stringMapTime = measure([&](llvm::StringRef word) {
+        auto it = keywordMap.find(word);
+        return it != keywordMap.end() ? it->second : Token::Identifier;
+    });
+    llvm::outs() << llvm::format("classified %zu identifiers and keywords: perfect hash %.2f ns/lookup, StringMap %.2f ns/lookup\n", words.size(),
+                                 perfectHashTime, stringMapTime);
+}
+
+/// Parses the given files into a fresh module over and over, and prints the throughput of the parser, including lexing and AST
+/// allocation.
+static void runParserBenchmark(llvm::ArrayRef<std::string> paths, uint64_t bytesPerIteration) {
+    CompileOptions options;
+    auto [count, seconds] = repeat(1.0, [&] {
+        Module module("benchmark");
+        for (auto& path : paths) {
+            Parser(path, module, options).parse();
+        }
+    });
+
+    double megabytes = double(bytesPerIteration) * double(count) / (1024 * 1024);
+    llvm::outs() << llvm::format("parsed %zu files %llu times in %.3f s: %.1f MB/s\n", paths.size(), (unsigned long long) count, seconds,
+                                 megabytes / seconds);
+}
+
+int main(int argc, const char** argv) {
+    llvm::InitLLVM x(argc, argv);
+    cl::ParseCommandLineOptions(argc, argv, "C* front-end benchmarks\n");
+
+    std::vector<FileID> files;
+    uint64_t bytesPerIteration = 0;
+
+    for (auto& path : inputs) {
+        auto file = SourceManager::get().loadFile(path);
+        if (!file) ABORT("couldn't read file '" << path << "': " << file.getError().message());
+        files.push_back(*file);
+        bytesPerIteration += SourceManager::get().getContents(*file).size();
+    }
+
+    runLexerBenchmark(files, bytesPerIteration);
+    runKeywordLookupBenchmark(files);
+    runParserBenchmark(inputs, bytesPerIteration);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+
+# Measures the throughput of the lexer and the parser over the standard library and over a large synthetic file.
+# Usage: benchmark-lexer.py [path-to-cx-benchmark] [synthetic-file-size-in-MB]
+
+import glob
+import os
+import subprocess
+import sys
+import tempfile
+
+cx_benchmark_path = sys.argv[1] if len(sys.argv) > 1 else "cx-benchmark"
+synthetic_file_size = int(sys.argv[2]) * 1024 * 1024 if len(sys.argv) > 2 else 64 * 1024 * 1024
+root_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+std_files = sorted(glob.glob(os.path.join(root_dir, "std", "**", "*.cx"), recursive=True))
+
+# The synthetic file mixes the kinds of input the lexer has fast paths for: indentation, long identifiers,
+# line and block comments, and string literals with escapes, in roughly the proportions of generated code.
+chunk = """
+/// Documentation comment for generated function number {0}, which is long enough to span several lines
+/// of output in a typical code generator and exercises the comment skipping of the lexer.
+int generatedFunctionWithAVeryLongDescriptiveName_{0}(int firstParameterValue, int secondParameterValue) {{
+    /* Block comment with nested /* comment */ and some * and / characters in it. */
+    var someIntermediateResultVariable = firstParameterValue * 0x{0:x} + secondParameterValue - {0};
+    var message = "generated string literal number {0} with \\"escaped quotes\\" and a tab\\t inside";
+    if (someIntermediateResultVariable >= {0} && message.size() != 0) {{
+        return someIntermediateResultVariable << 2; // trailing line comment
+    }}
+    return generatedFunctionWithAVeryLongDescriptiveName_{0}(secondParameterValue, firstParameterValue + 1);
+}}
+"""
+
+with tempfile.TemporaryDirectory() as temp_dir:
+    synthetic_file_path = os.path.join(temp_dir, "synthetic.cx")
+    with open(synthetic_file_path, "w") as synthetic_file:
+        size = 0
+        index = 0
+        while size < synthetic_file_size:
+            size += synthetic_file.write(chunk.format(index))
+            index += 1
+
+    for name, files in [("std", std_files), ("synthetic", [synthetic_file_path])]:
+        print(name + ": ", end="", flush=True)
+        if subprocess.call([cx_benchmark_path] + files) != 0:
+            sys.exit(1)
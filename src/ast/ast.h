@@ -9,7 +9,7 @@ namespace cx {
 struct Type;
 
 template<typename T>
-std::vector<T> instantiate(llvm::ArrayRef<T> elements, const llvm::StringMap<Type>& genericArgs) {
+std::vector<T> instantiate(llvm::ArrayRef<T> elements, const llvm::DenseMap<Identifier, Type>& genericArgs) {
     return map(elements, [&](const T& element) { return element->instantiate(genericArgs); });
 }
 
@@ -7,17 +7,17 @@
 
 using namespace cx;
 
-FunctionProto FunctionProto::instantiate(const llvm::StringMap<Type>& genericArgs) const {
+FunctionProto FunctionProto::instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs) const {
     auto params = instantiateParams(getParams(), genericArgs);
     auto returnType = getReturnType().resolve(genericArgs);
     std::vector<GenericParamDecl> genericParams;
-    return FunctionProto(getName().str(), std::move(params), returnType, isVarArg(), isExtern());
+    return FunctionProto(name, std::move(params), returnType, isVarArg(), isExtern());
 }
 
-FunctionDecl* FunctionTemplate::instantiate(const llvm::StringMap<Type>& genericArgs) {
+FunctionDecl* FunctionTemplate::instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs) {
     ASSERT(!genericParams.empty() && !genericArgs.empty());
 
-    auto orderedGenericArgs = map(genericParams, [&](auto& genericParam) { return genericArgs.find(genericParam.getName())->second; });
+    auto orderedGenericArgs = map(genericParams, [&](auto& genericParam) { return genericArgs.find(genericParam.getIdentifier())->second; });
 
     auto it = instantiations.find(orderedGenericArgs);
     if (it != instantiations.end()) return it->second;
@@ -56,7 +56,7 @@ bool FunctionDecl::signatureMatches(const FunctionDecl& other, bool matchReceive
     return true;
 }
 
-FunctionDecl* FunctionDecl::instantiate(const llvm::StringMap<Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray) {
+FunctionDecl* FunctionDecl::instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray) {
     if (auto methodDecl = llvm::dyn_cast<MethodDecl>(this)) {
         return methodDecl->instantiate(genericArgs, genericArgsArray, *getTypeDecl());
     } else {
@@ -84,7 +84,7 @@ bool FunctionTemplate::isReferenced() const {
 MethodDecl::MethodDecl(DeclKind kind, FunctionProto proto, TypeDecl& typeDecl, std::vector<Type>&& genericArgs, AccessLevel accessLevel, SourceLocation location)
 : FunctionDecl(kind, std::move(proto), std::move(genericArgs), accessLevel, *typeDecl.getModule(), location), typeDecl(&typeDecl) {}
 
-MethodDecl* MethodDecl::instantiate(const llvm::StringMap<Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray, TypeDecl& typeDecl) {
+MethodDecl* MethodDecl::instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray, TypeDecl& typeDecl) {
     switch (getKind()) {
         case DeclKind::MethodDecl: {
             auto* methodDecl = llvm::cast<MethodDecl>(this);
@@ -113,14 +113,14 @@ MethodDecl* MethodDecl::instantiate(const llvm::StringMap<Type>& genericArgs, ll
     }
 }
 
-FieldDecl FieldDecl::instantiate(const llvm::StringMap<Type>& genericArgs, TypeDecl& typeDecl) const {
+FieldDecl FieldDecl::instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs, TypeDecl& typeDecl) const {
     auto type = getType().resolve(genericArgs);
     auto defaultValue = getDefaultValue() ? getDefaultValue()->instantiate(genericArgs) : nullptr;
-    return FieldDecl(type, getName().str(), defaultValue, typeDecl, getAccessLevel(), location);
+    return FieldDecl(type, name, defaultValue, typeDecl, getAccessLevel(), location);
 }
 
-std::vector<ParamDecl> cx::instantiateParams(llvm::ArrayRef<ParamDecl> params, const llvm::StringMap<Type>& genericArgs) {
-    return map(params, [&](auto& param) { return ParamDecl(param.getType().resolve(genericArgs), param.getName().str(), param.isPublic, param.getLocation()); });
+std::vector<ParamDecl> cx::instantiateParams(llvm::ArrayRef<ParamDecl> params, const llvm::DenseMap<Identifier, Type>& genericArgs) {
+    return map(params, [&](auto& param) { return ParamDecl(param.getType().resolve(genericArgs), param.name, param.isPublic, param.getLocation()); });
 }
 
 std::string TypeDecl::getQualifiedName() const {
@@ -186,9 +186,9 @@ unsigned TypeDecl::getFieldIndex(const FieldDecl* field) const {
     llvm_unreachable("unknown field");
 }
 
-TypeDecl* TypeTemplate::instantiate(const llvm::StringMap<Type>& genericArgs) {
+TypeDecl* TypeTemplate::instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs) {
     ASSERT(!genericParams.empty() && !genericArgs.empty());
-    auto orderedGenericArgs = map(genericParams, [&](auto& genericParam) { return genericArgs.find(genericParam.getName())->second; });
+    auto orderedGenericArgs = map(genericParams, [&](auto& genericParam) { return genericArgs.find(genericParam.getIdentifier())->second; });
 
     auto it = instantiations.find(orderedGenericArgs);
     if (it != instantiations.end()) return it->second;
@@ -199,17 +199,17 @@ TypeDecl* TypeTemplate::instantiate(const llvm::StringMap<Type>& genericArgs) {
 
 TypeDecl* TypeTemplate::instantiate(llvm::ArrayRef<Type> genericArgs) {
     ASSERT(genericArgs.size() == genericParams.size());
-    llvm::StringMap<Type> genericArgsMap;
+    llvm::DenseMap<Identifier, Type> genericArgsMap;
 
     for (auto&& [genericArg, genericParam] : llvm::zip_first(genericArgs, genericParams)) {
-        genericArgsMap[genericParam.getName()] = genericArg;
+        genericArgsMap[genericParam.getIdentifier()] = genericArg;
     }
 
     return instantiate(genericArgsMap);
 }
 
-EnumCase::EnumCase(std::string&& name, Expr* value, Type associatedType, AccessLevel accessLevel, SourceLocation location)
-: VariableDecl(DeclKind::EnumCase, accessLevel, nullptr, Type() /* initialized by EnumDecl constructor */), name(std::move(name)), value(value),
+EnumCase::EnumCase(Identifier name, Expr* value, Type associatedType, AccessLevel accessLevel, SourceLocation location)
+: VariableDecl(DeclKind::EnumCase, accessLevel, nullptr, Type() /* initialized by EnumDecl constructor */), name(name), value(value),
   associatedType(associatedType), location(location) {}
 
 EnumCase* EnumDecl::getCaseByName(llvm::StringRef name) {
@@ -246,7 +246,7 @@ bool Decl::hasBeenMoved() const {
 }
 
 // TODO: Ensure that the same decl isn't instantiated multiple times with same generic args, to avoid duplicate work.
-Decl* Decl::instantiate(const llvm::StringMap<Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray) const {
+Decl* Decl::instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray) const {
     switch (getKind()) {
         case DeclKind::ParamDecl:
             llvm_unreachable("handled in FunctionProto::instantiate()");
@@ -268,11 +268,11 @@ Decl* Decl::instantiate(const llvm::StringMap<Type>& genericArgs, llvm::ArrayRef
         case DeclKind::TypeDecl: {
             auto* typeDecl = llvm::cast<TypeDecl>(this);
             auto interfaces = map(typeDecl->getInterfaces(), [&](Type type) { return type.resolve(genericArgs); });
-            auto instantiation = new TypeDecl(typeDecl->getTag(), typeDecl->getName().str(), genericArgsArray, std::move(interfaces), getAccessLevel(),
+            auto instantiation = new TypeDecl(typeDecl->getTag(), Identifier(typeDecl->getName()), genericArgsArray, std::move(interfaces), getAccessLevel(),
                                               *typeDecl->getModule(), typeDecl, typeDecl->getLocation());
             for (auto& field : typeDecl->getFields()) {
                 auto defaultValue = field.getDefaultValue() ? field.getDefaultValue()->instantiate(genericArgs) : nullptr;
-                instantiation->addField(FieldDecl(field.getType().resolve(genericArgs), field.getName().str(), defaultValue, *instantiation,
+                instantiation->addField(FieldDecl(field.getType().resolve(genericArgs), Identifier(field.getName()), defaultValue, *instantiation,
                                                   field.getAccessLevel(), field.getLocation()));
             }
 
@@ -288,7 +288,7 @@ Decl* Decl::instantiate(const llvm::StringMap<Type>& genericArgs, llvm::ArrayRef
                     genericParams.reserve(functionTemplate->getGenericParams().size());
 
                     for (auto& genericParam : functionTemplate->getGenericParams()) {
-                        genericParams.emplace_back(genericParam.getName().str(), genericParam.getLocation());
+                        genericParams.emplace_back(genericParam.getIdentifier(), genericParam.getLocation());
                         genericParams.back().setConstraints(genericParam.getConstraints());
                     }
 
@@ -310,7 +310,7 @@ Decl* Decl::instantiate(const llvm::StringMap<Type>& genericArgs, llvm::ArrayRef
             auto* varDecl = llvm::cast<VarDecl>(this);
             auto type = varDecl->getType().resolve(genericArgs);
             auto initializer = varDecl->getInitializer() ? varDecl->getInitializer()->instantiate(genericArgs) : nullptr;
-            return new VarDecl(type, varDecl->getName().str(), initializer, varDecl->getParentDecl(), getAccessLevel(), *varDecl->getModule(),
+            return new VarDecl(type, Identifier(varDecl->getName()), initializer, varDecl->getParentDecl(), getAccessLevel(), *varDecl->getModule(),
                                varDecl->getLocation());
         }
         case DeclKind::FieldDecl:
@@ -330,10 +330,12 @@ bool Decl::isGlobal() const {
 }
 
 ConstructorDecl::ConstructorDecl(TypeDecl& receiverTypeDecl, std::vector<ParamDecl>&& params, AccessLevel accessLevel, SourceLocation location)
-: MethodDecl(DeclKind::ConstructorDecl, FunctionProto("init", std::move(params), Type::getVoid(), false, false), receiverTypeDecl, {}, accessLevel, location) {}
+: MethodDecl(DeclKind::ConstructorDecl, FunctionProto(Identifier("init"), std::move(params), Type::getVoid(), false, false), receiverTypeDecl, {}, accessLevel,
+             location) {}
 
 DestructorDecl::DestructorDecl(TypeDecl& receiverTypeDecl, SourceLocation location)
-: MethodDecl(DeclKind::DestructorDecl, FunctionProto("deinit", {}, Type::getVoid(), false, false), receiverTypeDecl, {}, AccessLevel::None, location) {}
+: MethodDecl(DeclKind::DestructorDecl, FunctionProto(Identifier("deinit"), {}, Type::getVoid(), false, false), receiverTypeDecl, {}, AccessLevel::None,
+             location) {}
 
 std::vector<Note> cx::getPreviousDefinitionNotes(llvm::ArrayRef<Decl*> decls) {
     return map(decls, [](Decl* decl) { return Note { decl->getLocation(), "previous definition here" }; });
@@ -9,6 +9,7 @@
 #include <llvm/Support/Casting.h>
 #pragma warning(pop)
 #include "expr.h"
+#include "identifier.h"
 #include "location.h"
 #include "stmt.h"
 #include "type.h"
@@ -108,7 +109,7 @@ struct Decl {
     virtual bool isReferenced() const { return referenced; }
     void setReferenced(bool referenced) { this->referenced = referenced; }
     bool hasBeenMoved() const;
-    Decl* instantiate(const llvm::StringMap<Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray) const;
+    Decl* instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray) const;
 
 protected:
     Decl(DeclKind kind, AccessLevel accessLevel) : kind(kind), accessLevel(accessLevel), referenced(false) {}
@@ -146,26 +147,27 @@ private:
 };
 
 struct ParamDecl : VariableDecl, Movable {
-    ParamDecl(Type type, std::string&& name, bool isPublic, SourceLocation location)
-    : VariableDecl(DeclKind::ParamDecl, AccessLevel::None, nullptr /* initialized by FunctionDecl constructor */, type), name(std::move(name)),
+    ParamDecl(Type type, Identifier name, bool isPublic, SourceLocation location)
+    : VariableDecl(DeclKind::ParamDecl, AccessLevel::None, nullptr /* initialized by FunctionDecl constructor */, type), name(name),
       location(location), isPublic(isPublic) {}
     llvm::StringRef getName() const override { return name; }
     Module* getModule() const override { return nullptr; }
     SourceLocation getLocation() const override { return location; }
     static bool classof(const Decl* d) { return d->getKind() == DeclKind::ParamDecl; }
-    bool operator==(const ParamDecl& other) const { return getType() == other.getType() && getName() == other.getName(); }
+    bool operator==(const ParamDecl& other) const { return getType() == other.getType() && name == other.name; }
 
-    std::string name;
+    Identifier name;
     SourceLocation location;
     bool isPublic;
 };
 
-std::vector<ParamDecl> instantiateParams(llvm::ArrayRef<ParamDecl> params, const llvm::StringMap<Type>& genericArgs);
+std::vector<ParamDecl> instantiateParams(llvm::ArrayRef<ParamDecl> params, const llvm::DenseMap<Identifier, Type>& genericArgs);
 
 struct GenericParamDecl : Decl {
-    GenericParamDecl(std::string&& name, SourceLocation location)
-    : Decl(DeclKind::GenericParamDecl, AccessLevel::None), name(std::move(name)), location(location) {}
+    GenericParamDecl(Identifier name, SourceLocation location)
+    : Decl(DeclKind::GenericParamDecl, AccessLevel::None), name(name), location(location) {}
     llvm::StringRef getName() const override { return name; }
+    Identifier getIdentifier() const { return name; }
     llvm::ArrayRef<Type> getConstraints() const { return constraints; }
     void setConstraints(llvm::ArrayRef<Type> c) { constraints.assign(c.begin(), c.end()); }
     Module* getModule() const override { return nullptr; }
@@ -173,14 +175,14 @@ struct GenericParamDecl : Decl {
     static bool classof(const Decl* d) { return d->getKind() == DeclKind::GenericParamDecl; }
 
 private:
-    std::string name;
+    Identifier name;
     llvm::SmallVector<Type, 1> constraints;
     SourceLocation location;
 };
 
 struct FunctionProto {
-    FunctionProto(std::string&& name, std::vector<ParamDecl>&& params, Type returnType, bool isVarArg, bool isExtern)
-    : name(std::move(name)), params(std::move(params)), returnType(returnType), varArg(isVarArg), external(isExtern) {}
+    FunctionProto(Identifier name, std::vector<ParamDecl>&& params, Type returnType, bool isVarArg, bool isExtern)
+    : name(name), params(std::move(params)), returnType(returnType), varArg(isVarArg), external(isExtern) {}
     llvm::StringRef getName() const { return name; }
     llvm::ArrayRef<ParamDecl> getParams() const { return params; }
     llvm::MutableArrayRef<ParamDecl> getParams() { return params; }
@@ -188,9 +190,9 @@ struct FunctionProto {
     void setReturnType(Type type) { returnType = type; }
     bool isVarArg() const { return varArg; }
     bool isExtern() const { return external; }
-    FunctionProto instantiate(const llvm::StringMap<Type>& genericArgs) const;
+    FunctionProto instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs) const;
 
-    std::string name;
+    Identifier name;
     std::vector<ParamDecl> params;
     Type returnType;
     bool varArg;
@@ -218,15 +220,24 @@ struct FunctionDecl : Decl {
     const FunctionProto& getProto() const { return proto; }
     FunctionProto& getProto() { return proto; }
     virtual TypeDecl* getTypeDecl() const { return nullptr; }
-    bool hasBody() const { return body.hasValue(); }
+    bool hasBody() const { return body.hasValue() || hasLazyBody(); }
     llvm::ArrayRef<Stmt*> getBody() const { return *body; }
     llvm::MutableArrayRef<Stmt*> getBody() { return *body; }
-    void setBody(std::vector<Stmt*>&& body) { this->body = std::move(body); }
+    void setBody(std::vector<Stmt*>&& body) {
+        this->body = std::move(body);
+        lazyBodyLocation = SourceLocation();
+    }
+    /// Returns true if the parser skipped the body of this function. The body must be parsed with parseLazyFunctionBody() before
+    /// it can be accessed with getBody().
+    bool hasLazyBody() const { return lazyBodyLocation.isValid(); }
+    /// Returns the location of the opening brace of the skipped body, or an invalid location if the body isn't lazy.
+    SourceLocation getLazyBodyLocation() const { return lazyBodyLocation; }
+    void setLazyBody(SourceLocation bodyLocation) { lazyBodyLocation = bodyLocation; }
     SourceLocation getLocation() const override { return location; }
     FunctionType* getFunctionType() const;
     bool signatureMatches(const FunctionDecl& other, bool matchReceiver = true) const;
     Module* getModule() const override { return &module; }
-    FunctionDecl* instantiate(const llvm::StringMap<Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray);
+    FunctionDecl* instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray);
     bool isTypechecked() const { return typechecked; }
     void setTypechecked(bool typechecked) { this->typechecked = typechecked; }
     static bool classof(const Decl* d) { return d->isFunctionDecl(); }
@@ -239,6 +250,7 @@ private:
     FunctionProto proto;
     std::vector<Type> genericArgs;
     llvm::Optional<std::vector<Stmt*>> body;
+    SourceLocation lazyBodyLocation;
     SourceLocation location;
     Module& module;
     bool typechecked;
@@ -248,7 +260,7 @@ struct MethodDecl : FunctionDecl {
     MethodDecl(FunctionProto proto, TypeDecl& receiverTypeDecl, std::vector<Type>&& genericArgs, AccessLevel accessLevel, SourceLocation location)
     : MethodDecl(DeclKind::MethodDecl, std::move(proto), receiverTypeDecl, std::move(genericArgs), accessLevel, location) {}
     TypeDecl* getTypeDecl() const override { return typeDecl; }
-    MethodDecl* instantiate(const llvm::StringMap<Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray, TypeDecl& typeDecl);
+    MethodDecl* instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs, llvm::ArrayRef<Type> genericArgsArray, TypeDecl& typeDecl);
     static bool classof(const Decl* d) { return d->isMethodDecl(); }
 
 protected:
@@ -277,7 +289,7 @@ struct FunctionTemplate : Decl {
     static bool classof(const Decl* d) { return d->isFunctionTemplate(); }
     llvm::ArrayRef<GenericParamDecl> getGenericParams() const { return genericParams; }
     FunctionDecl* getFunctionDecl() const { return functionDecl; }
-    FunctionDecl* instantiate(const llvm::StringMap<Type>& genericArgs);
+    FunctionDecl* instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs);
     Module* getModule() const override { return functionDecl->getModule(); }
     SourceLocation getLocation() const override { return functionDecl->getLocation(); }
 
@@ -291,9 +303,9 @@ enum class TypeTag { Struct, Interface, Union, Enum };
 
 /// A non-template function declaration or a function template instantiation.
 struct TypeDecl : Decl {
-    TypeDecl(TypeTag tag, std::string&& name, std::vector<Type>&& genericArgs, std::vector<Type>&& interfaces, AccessLevel accessLevel, Module& module,
+    TypeDecl(TypeTag tag, Identifier name, std::vector<Type>&& genericArgs, std::vector<Type>&& interfaces, AccessLevel accessLevel, Module& module,
              const TypeDecl* instantiatedFrom, SourceLocation location)
-    : Decl(DeclKind::TypeDecl, accessLevel), tag(tag), name(std::move(name)), genericArgs(std::move(genericArgs)), interfaces(std::move(interfaces)),
+    : Decl(DeclKind::TypeDecl, accessLevel), tag(tag), name(name), genericArgs(std::move(genericArgs)), interfaces(std::move(interfaces)),
       location(location), module(module), instantiatedFrom(instantiatedFrom) {}
     TypeTag getTag() const { return tag; }
     llvm::StringRef getName() const override { return name; }
@@ -320,11 +332,11 @@ struct TypeDecl : Decl {
     Module* getModule() const override { return &module; }
     const TypeDecl* getInstantiatedFrom() const { return instantiatedFrom; }
     static bool classof(const Decl* d) { return d->isTypeDecl(); }
-    TypeDecl(DeclKind kind, TypeTag tag, std::string&& name, AccessLevel accessLevel, Module& module, const TypeDecl* instantiatedFrom, SourceLocation location)
-    : Decl(kind, accessLevel), tag(tag), name(std::move(name)), location(location), module(module), instantiatedFrom(instantiatedFrom) {}
+    TypeDecl(DeclKind kind, TypeTag tag, Identifier name, AccessLevel accessLevel, Module& module, const TypeDecl* instantiatedFrom, SourceLocation location)
+    : Decl(kind, accessLevel), tag(tag), name(name), location(location), module(module), instantiatedFrom(instantiatedFrom) {}
 
     TypeTag tag;
-    std::string name;
+    Identifier name;
     std::vector<Type> genericArgs;
     std::vector<Type> interfaces;
     std::vector<FieldDecl> fields;
@@ -341,7 +353,7 @@ struct TypeTemplate : Decl {
     llvm::ArrayRef<GenericParamDecl> getGenericParams() const { return genericParams; }
     llvm::StringRef getName() const override { return getTypeDecl()->getName(); }
     TypeDecl* getTypeDecl() const { return typeDecl; }
-    TypeDecl* instantiate(const llvm::StringMap<Type>& genericArgs);
+    TypeDecl* instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs);
     TypeDecl* instantiate(llvm::ArrayRef<Type> genericArgs);
     Module* getModule() const override { return typeDecl->getModule(); }
     SourceLocation getLocation() const override { return typeDecl->getLocation(); }
@@ -354,7 +366,7 @@ private:
 };
 
 struct EnumCase : VariableDecl {
-    EnumCase(std::string&& name, Expr* value, Type associatedType, AccessLevel accessLevel, SourceLocation location);
+    EnumCase(Identifier name, Expr* value, Type associatedType, AccessLevel accessLevel, SourceLocation location);
     llvm::StringRef getName() const override { return name; }
     Expr* getValue() const { return value; }
     Type getAssociatedType() const { return associatedType; }
@@ -364,14 +376,14 @@ struct EnumCase : VariableDecl {
     static bool classof(const Decl* d) { return d->getKind() == DeclKind::EnumCase; }
 
 private:
-    std::string name;
+    Identifier name;
     Expr* value;
     Type associatedType;
     SourceLocation location;
 };
 
 struct EnumDecl : TypeDecl {
-    EnumDecl(std::string&& name, std::vector<EnumCase>&& cases, AccessLevel accessLevel, Module& module, const TypeDecl* instantiatedFrom, SourceLocation location)
+    EnumDecl(Identifier name, std::vector<EnumCase>&& cases, AccessLevel accessLevel, Module& module, const TypeDecl* instantiatedFrom, SourceLocation location)
     : TypeDecl(DeclKind::EnumDecl, TypeTag::Enum, std::move(name), accessLevel, module, instantiatedFrom, location), cases(std::move(cases)) {
         for (auto& enumCase : this->cases) {
             enumCase.setParentDecl(this);
@@ -390,8 +402,8 @@ private:
 };
 
 struct VarDecl : VariableDecl, Movable {
-    VarDecl(Type type, std::string&& name, Expr* initializer, Decl* parent, AccessLevel accessLevel, Module& module, SourceLocation location)
-    : VariableDecl(DeclKind::VarDecl, accessLevel, parent, type), name(std::move(name)), initializer(initializer), location(location), module(module) {}
+    VarDecl(Type type, Identifier name, Expr* initializer, Decl* parent, AccessLevel accessLevel, Module& module, SourceLocation location)
+    : VariableDecl(DeclKind::VarDecl, accessLevel, parent, type), name(name), initializer(initializer), location(location), module(module) {}
     llvm::StringRef getName() const override { return name; }
     Expr* getInitializer() const { return initializer; }
     void setInitializer(Expr* expr) { initializer = expr; }
@@ -400,26 +412,26 @@ struct VarDecl : VariableDecl, Movable {
     static bool classof(const Decl* d) { return d->getKind() == DeclKind::VarDecl; }
 
 private:
-    std::string name;
+    Identifier name;
     Expr* initializer;
     SourceLocation location;
     Module& module;
 };
 
 struct FieldDecl : VariableDecl {
-    FieldDecl(Type type, std::string&& name, Expr* defaultValue, TypeDecl& parent, AccessLevel accessLevel, SourceLocation location)
-    : VariableDecl(DeclKind::FieldDecl, accessLevel, &parent, type), name(std::move(name)), defaultValue(defaultValue), location(location) {}
+    FieldDecl(Type type, Identifier name, Expr* defaultValue, TypeDecl& parent, AccessLevel accessLevel, SourceLocation location)
+    : VariableDecl(DeclKind::FieldDecl, accessLevel, &parent, type), name(name), defaultValue(defaultValue), location(location) {}
     llvm::StringRef getName() const override { return name; }
     std::string getQualifiedName() const;
     Expr* getDefaultValue() const { return defaultValue; }
     TypeDecl* getParentDecl() const { return llvm::cast<TypeDecl>(VariableDecl::getParentDecl()); }
     Module* getModule() const override { return getParentDecl()->getModule(); }
     SourceLocation getLocation() const override { return location; }
-    FieldDecl instantiate(const llvm::StringMap<Type>& genericArgs, TypeDecl& typeDecl) const;
+    FieldDecl instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs, TypeDecl& typeDecl) const;
     static bool classof(const Decl* d) { return d->getKind() == DeclKind::FieldDecl; }
 
 private:
-    std::string name;
+    Identifier name;
     Expr* defaultValue;
     SourceLocation location;
 };
@@ -1,4 +1,5 @@
 #include "expr.h"
+#include <atomic>
 #pragma warning(push, 0)
 #include <llvm/Support/ErrorHandling.h>
 #pragma warning(pop)
@@ -136,13 +137,13 @@ bool Expr::isLvalue() const {
     }
 }
 
-Expr* Expr::instantiate(const llvm::StringMap<Type>& genericArgs) const {
+Expr* Expr::instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs) const {
     switch (getKind()) {
         case ExprKind::VarExpr: {
             auto* varExpr = llvm::cast<VarExpr>(this);
             auto it = genericArgs.find(varExpr->getIdentifier());
-            auto identifier = it != genericArgs.end() ? it->second.getName() : varExpr->getIdentifier();
-            return new VarExpr(identifier.str(), varExpr->getLocation());
+            auto identifier = it != genericArgs.end() ? Identifier(it->second.getName()) : varExpr->getIdentifier();
+            return new VarExpr(identifier, varExpr->getLocation());
         }
         case ExprKind::StringLiteralExpr: {
             auto* stringLiteralExpr = llvm::cast<StringLiteralExpr>(this);
@@ -388,12 +389,20 @@ llvm::APSInt BinaryExpr::getConstantIntegerValue() const {
     }
 }
 
+static std::string createLambdaName() {
+    static std::atomic<uint64_t> nameCounter(0);
+    return "__lambda" + std::to_string(nameCounter++);
+}
+
 LambdaExpr::LambdaExpr(std::vector<ParamDecl>&& params, Module* module, SourceLocation location) : Expr(ExprKind::LambdaExpr, location) {
-    static uint64_t nameCounter = 0;
-    FunctionProto proto("__lambda" + std::to_string(nameCounter++), std::move(params), Type(), false, false);
+    FunctionProto proto(Identifier(createLambdaName()), std::move(params), Type(), false, false);
     this->functionDecl = new FunctionDecl(std::move(proto), std::vector<Type>(), AccessLevel::Private, *module, getLocation());
 }
 
+void LambdaExpr::rename() {
+    functionDecl->getProto().name = Identifier(createLambdaName());
+}
+
 VarDeclExpr::VarDeclExpr(VarDecl* varDecl) : Expr(ExprKind::VarDeclExpr, varDecl->getLocation()), varDecl(varDecl) {}
 
 const Expr* TupleExpr::getElementByName(llvm::StringRef name) const {
@@ -90,7 +90,7 @@ struct Expr {
     llvm::APSInt getConstantIntegerValue() const;
     bool isLvalue() const;
     SourceLocation getLocation() const { return location; }
-    Expr* instantiate(const llvm::StringMap<Type>& genericArgs) const;
+    Expr* instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs) const;
     FieldDecl* getFieldDecl() const;
     const Expr* withoutImplicitCast() const;
     bool isThis() const;
@@ -108,15 +108,15 @@ private:
 inline Expr::~Expr() {}
 
 struct VarExpr : Expr {
-    VarExpr(std::string&& identifier, SourceLocation location) : Expr(ExprKind::VarExpr, location), decl(nullptr), identifier(std::move(identifier)) {}
+    VarExpr(Identifier identifier, SourceLocation location) : Expr(ExprKind::VarExpr, location), decl(nullptr), identifier(identifier) {}
     Decl* getDecl() const { return decl; }
     void setDecl(Decl* newDecl) { decl = newDecl; }
-    llvm::StringRef getIdentifier() const { return identifier; }
+    Identifier getIdentifier() const { return identifier; }
     static bool classof(const Expr* e) { return e->getKind() == ExprKind::VarExpr; }
 
 private:
     Decl* decl;
-    std::string identifier;
+    Identifier identifier;
 };
 
 struct StringLiteralExpr : Expr {
@@ -260,7 +260,7 @@ private:
 
 struct UnaryExpr : CallExpr {
     UnaryExpr(UnaryOperator op, Expr* operand, SourceLocation location)
-    : CallExpr(ExprKind::UnaryExpr, new VarExpr(toString(op.getKind()), location), { NamedValue(operand) }, location), op(op) {}
+    : CallExpr(ExprKind::UnaryExpr, new VarExpr(Identifier(toString(op.getKind())), location), { NamedValue(operand) }, location), op(op) {}
     UnaryOperator getOperator() const { return op; }
     Expr& getOperand() { return *getArgs()[0].getValue(); }
     const Expr& getOperand() const { return *getArgs()[0].getValue(); }
@@ -273,7 +273,7 @@ private:
 
 struct BinaryExpr : CallExpr {
     BinaryExpr(BinaryOperator op, Expr* left, Expr* right, SourceLocation location)
-    : CallExpr(ExprKind::BinaryExpr, new VarExpr(cx::getFunctionName(op), location), { NamedValue(left), NamedValue(right) }, location), op(op) {}
+    : CallExpr(ExprKind::BinaryExpr, new VarExpr(Identifier(cx::getFunctionName(op)), location), { NamedValue(left), NamedValue(right) }, location), op(op) {}
     BinaryOperator getOperator() const { return op; }
     const Expr& getLHS() const { return *getArgs()[0].getValue(); }
     const Expr& getRHS() const { return *getArgs()[1].getValue(); }
@@ -368,6 +368,8 @@ private:
 struct LambdaExpr : Expr {
     LambdaExpr(std::vector<ParamDecl>&& params, Module* module, SourceLocation location);
     FunctionDecl* getFunctionDecl() const { return functionDecl; }
+    /// Gives the lambda's function the next unique lambda name.
+    void rename();
     static bool classof(const Expr* e) { return e->getKind() == ExprKind::LambdaExpr; }
 
     FunctionDecl* functionDecl;
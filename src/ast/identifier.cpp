@@ -0,0 +1,60 @@
+#include "identifier.h"
+#include <cstring>
+#include <mutex>
+#pragma warning(push, 0)
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/Support/Allocator.h>
+#pragma warning(pop)
+#include "../support/utility.h"
+
+using namespace cx;
+
+namespace {
+
+/// One of the independently locked parts of the identifier table, so that threads lexing different files rarely contend for
+/// the same lock. Each identifier is stored as its 32-bit length followed by its null-terminated characters.
+struct IdentifierTableShard {
+    std::mutex mutex;
+    llvm::BumpPtrAllocator allocator;
+    llvm::DenseMap<llvm::StringRef, const char*> identifiers;
+};
+
+} // namespace
+
+static constexpr size_t identifierTableShardCount = 16;
+
+static IdentifierTableShard& getIdentifierTableShard(llvm::StringRef string) {
+    static IdentifierTableShard shards[identifierTableShardCount];
+    return shards[size_t(llvm::hash_value(string)) % identifierTableShardCount];
+}
+
+const char* Identifier::lookUp(llvm::StringRef string) {
+    if (string.empty()) return nullptr;
+
+    auto& shard = getIdentifierTableShard(string);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.identifiers.find(string);
+    return it != shard.identifiers.end() ? it->second : nullptr;
+}
+
+const char* Identifier::intern(llvm::StringRef string) {
+    if (string.empty()) return nullptr;
+    if (string.size() > UINT32_MAX) ABORT("identifier is too long");
+
+    auto& shard = getIdentifierTableShard(string);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.identifiers.find(string);
+    if (it != shard.identifiers.end()) return it->second;
+
+    auto* memory = static_cast<char*>(shard.allocator.Allocate(sizeof(uint32_t) + string.size() + 1, alignof(uint32_t)));
+    uint32_t size = uint32_t(string.size());
+    std::memcpy(memory, &size, sizeof(size));
+    char* data = memory + sizeof(uint32_t);
+    std::memcpy(data, string.data(), string.size());
+    data[string.size()] = '\0';
+
+    shard.identifiers.try_emplace(llvm::StringRef(data, string.size()), data);
+    return data;
+}
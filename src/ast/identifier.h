@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#pragma warning(push, 0)
+#include <llvm/ADT/DenseMapInfo.h>
+#include <llvm/ADT/StringRef.h>
+#pragma warning(pop)
+
+namespace cx {
+
+/// A name interned in the global identifier table. Each distinct spelling is stored only once for the lifetime of the compiler,
+/// so identifiers are compared and hashed by pointer instead of by their characters. Interning is thread-safe.
+struct Identifier {
+private:
+    template<typename T>
+    using EnableIfString = std::enable_if_t<std::is_convertible_v<const T&, llvm::StringRef> && !std::is_same_v<T, Identifier>>;
+
+public:
+    /// Constructs the empty identifier.
+    Identifier() : data(nullptr) {}
+    /// Interns the given string, returning the identifier with that spelling. Interning allocates memory that's never freed, so
+    /// it's explicit, and names that are only looked up should use find() instead.
+    explicit Identifier(llvm::StringRef string) : data(intern(string)) {}
+    explicit Identifier(const char* string) : Identifier(llvm::StringRef(string)) {}
+    explicit Identifier(const std::string& string) : Identifier(llvm::StringRef(string)) {}
+    /// Returns the identifier with the given spelling if it has been interned, or the empty identifier otherwise. Since nothing can
+    /// be declared with a name that hasn't been interned, this is enough for looking up names without interning them.
+    static Identifier find(llvm::StringRef string) { return Identifier(lookUp(string), 0); }
+    llvm::StringRef getString() const { return data ? llvm::StringRef(data, reinterpret_cast<const uint32_t*>(data)[-1]) : llvm::StringRef(); }
+    operator llvm::StringRef() const { return getString(); }
+    std::string str() const { return getString().str(); }
+    bool empty() const { return data == nullptr; }
+    /// Returns a null-terminated pointer to the interned characters, or null for the empty identifier.
+    const char* getOpaqueValue() const { return data; }
+    static Identifier getFromOpaqueValue(const char* data) { return Identifier(data, 0); }
+    friend bool operator==(Identifier a, Identifier b) { return a.data == b.data; }
+    friend bool operator!=(Identifier a, Identifier b) { return a.data != b.data; }
+
+    // Comparisons with strings compare the characters. They're templates so that they're preferred over the implicit
+    // conversion from identifiers to strings, which would otherwise make these comparisons ambiguous.
+    template<typename T, typename = EnableIfString<T>>
+    friend bool operator==(Identifier a, const T& b) { return a.getString() == llvm::StringRef(b); }
+    template<typename T, typename = EnableIfString<T>>
+    friend bool operator==(const T& a, Identifier b) { return llvm::StringRef(a) == b.getString(); }
+    template<typename T, typename = EnableIfString<T>>
+    friend bool operator!=(Identifier a, const T& b) { return !(a == b); }
+    template<typename T, typename = EnableIfString<T>>
+    friend bool operator!=(const T& a, Identifier b) { return !(a == b); }
+
+private:
+    Identifier(const char* data, int) : data(data) {}
+    static const char* intern(llvm::StringRef string);
+    static const char* lookUp(llvm::StringRef string);
+
+private:
+    const char* data;
+};
+
+} // namespace cx
+
+namespace llvm {
+
+template<>
+struct DenseMapInfo<cx::Identifier> {
+    static cx::Identifier getEmptyKey() { return cx::Identifier::getFromOpaqueValue(DenseMapInfo<const char*>::getEmptyKey()); }
+    static cx::Identifier getTombstoneKey() { return cx::Identifier::getFromOpaqueValue(DenseMapInfo<const char*>::getTombstoneKey()); }
+    static unsigned getHashValue(cx::Identifier identifier) { return DenseMapInfo<const char*>::getHashValue(identifier.getOpaqueValue()); }
+    static bool isEqual(cx::Identifier a, cx::Identifier b) { return a == b; }
+};
+
+} // namespace llvm
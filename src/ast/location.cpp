@@ -0,0 +1,22 @@
+#include "location.h"
+#pragma warning(push, 0)
+#include <llvm/Support/raw_ostream.h>
+#pragma warning(pop)
+#include "source-manager.h"
+
+using namespace cx;
+
+FileID SourceLocation::getFileID() const {
+    return SourceManager::get().getFileID(*this);
+}
+
+DecodedLocation SourceLocation::decode() const {
+    return SourceManager::get().decode(*this);
+}
+
+bool SourceLocation::print() const {
+    auto decoded = decode();
+    if (!decoded.filePath || !*decoded.filePath) return false;
+    llvm::outs() << decoded.filePath << ':' << decoded.line << ':' << decoded.column;
+    return true;
+}
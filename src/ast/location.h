@@ -1,34 +1,47 @@
 #pragma once
 
-#include <limits>
-#pragma warning(push, 0)
-#include <llvm/Support/raw_ostream.h>
-#pragma warning(pop)
+#include <cstdint>
 
 namespace cx {
 
+/// Identifies a file loaded by the SourceManager. Zero is never a valid file ID.
+using FileID = uint32_t;
+
+/// The file path, line, and column of a SourceLocation, as computed by SourceLocation::decode().
+struct DecodedLocation {
+    FileID file;
+    const char* filePath;
+    unsigned line;
+    unsigned column;
+};
+
+/// A location in a source file, encoded as an offset into the single address space in which the SourceManager lays out all loaded
+/// files one after another. The file, line, and column are computed from the offset only when needed, e.g. for diagnostics.
 struct SourceLocation {
-    using IntegerType = short;
-
-    const char* file;
-    IntegerType line;
-    IntegerType column;
-
-    SourceLocation() : SourceLocation(nullptr, std::numeric_limits<IntegerType>::min(), std::numeric_limits<IntegerType>::min()) {}
-    SourceLocation(const char* file, IntegerType line, IntegerType column) : file(file), line(line), column(column) {}
-    SourceLocation nextColumn() const { return SourceLocation(file, line, column + 1); }
-    bool isValid() const { return line > 0 && column > 0; }
-
-    bool print() const {
-        if (file && *file) {
-            llvm::outs() << file;
-            if (isValid()) {
-                llvm::outs() << ':' << line << ':' << column;
-            }
-            return true;
-        }
-        return false;
+    SourceLocation() : offset(0) {}
+    static SourceLocation fromOffset(uint32_t offset) {
+        SourceLocation location;
+        location.offset = offset;
+        return location;
     }
+    uint32_t getOffset() const { return offset; }
+    /// Returns the location the given number of characters after this one in the same file.
+    SourceLocation getLocationWithOffset(int32_t delta) const { return fromOffset(offset + delta); }
+    SourceLocation nextColumn() const { return getLocationWithOffset(1); }
+    bool isValid() const { return offset != 0; }
+    bool operator==(SourceLocation other) const { return offset == other.offset; }
+    bool operator!=(SourceLocation other) const { return offset != other.offset; }
+
+    /// Returns the file containing this location, or 0 if the location is invalid.
+    FileID getFileID() const;
+    /// Decodes the location into a file path, line, and column. For invalid locations, the file path is null and the line and
+    /// column are 0.
+    DecodedLocation decode() const;
+    /// Prints the location in "file:line:column" format to stdout, returning false if there was nothing to print.
+    bool print() const;
+
+private:
+    uint32_t offset;
 };
 
 } // namespace cx
@@ -144,3 +144,19 @@ std::string cx::mangleFunctionDecl(const FunctionDecl& functionDecl) {
     stream.flush();
     return mangled;
 }
+
+std::string cx::mangleGlobalVariable(const VarDecl& varDecl) {
+    if (varDecl.getModule()->isCHeaderModule()) {
+        return varDecl.getName().str();
+    }
+
+    std::string mangled;
+    llvm::raw_string_ostream stream(mangled);
+    stream << cxPrefix;
+    stream << 'N';
+    mangleIdentifier(stream, varDecl.getModule()->getName());
+    mangleIdentifier(stream, varDecl.getName());
+    stream << 'E';
+    stream.flush();
+    return mangled;
+}
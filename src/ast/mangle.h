@@ -5,7 +5,9 @@
 namespace cx {
 
 struct FunctionDecl;
+struct VarDecl;
 
 std::string mangleFunctionDecl(const FunctionDecl& functionDecl);
+std::string mangleGlobalVariable(const VarDecl& varDecl);
 
 } // namespace cx
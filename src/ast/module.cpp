@@ -14,7 +14,7 @@ Module* Module::getStdlibModule() {
     return it->second;
 }
 
-void Module::addToSymbolTableWithName(Decl& decl, llvm::StringRef name) {
+void Module::addToSymbolTableWithName(Decl& decl, Identifier name) {
     if (auto existing = getSymbolTable().findInCurrentScope(name); !existing.empty()) {
         REPORT_ERROR_WITH_NOTES(decl.getLocation(), getPreviousDefinitionNotes(existing), "redefinition of '" << name << "'");
     }
@@ -30,24 +30,24 @@ void Module::addToSymbolTable(FunctionTemplate& decl) {
     if (auto existing = getSymbolTable().findWithMatchingPrototype(*decl.getFunctionDecl())) {
         REPORT_ERROR_WITH_NOTES(decl.getLocation(), getPreviousDefinitionNotes(existing), "redefinition of '" << decl.getQualifiedName() << "'");
     }
-    getSymbolTable().addGlobal(decl.getQualifiedName(), &decl);
+    getSymbolTable().addGlobal(Identifier(decl.getQualifiedName()), &decl);
 }
 
 void Module::addToSymbolTable(FunctionDecl& decl) {
     if (auto existing = getSymbolTable().findWithMatchingPrototype(decl)) {
         REPORT_ERROR_WITH_NOTES(decl.getLocation(), getPreviousDefinitionNotes(existing), "redefinition of '" << decl.getQualifiedName() << "'");
     }
-    getSymbolTable().addGlobal(decl.getQualifiedName(), &decl);
+    getSymbolTable().addGlobal(Identifier(decl.getQualifiedName()), &decl);
 }
 
 void Module::addToSymbolTable(TypeTemplate& decl) {
     llvm::cast<BasicType>(decl.getTypeDecl()->getType().getBase())->setDecl(decl.getTypeDecl());
-    addToSymbolTableWithName(decl, decl.getTypeDecl()->getName());
+    addToSymbolTableWithName(decl, Identifier(decl.getTypeDecl()->getName()));
 }
 
 void Module::addToSymbolTable(TypeDecl& decl) {
     llvm::cast<BasicType>(decl.getType().getBase())->setDecl(&decl);
-    addToSymbolTableWithName(decl, decl.getQualifiedName());
+    addToSymbolTableWithName(decl, Identifier(decl.getQualifiedName()));
 
     for (auto& memberDecl : decl.getMethods()) {
         if (auto* nonTemplateMethod = llvm::dyn_cast<MethodDecl>(memberDecl)) {
@@ -58,30 +58,103 @@ void Module::addToSymbolTable(TypeDecl& decl) {
 
 void Module::addToSymbolTable(EnumDecl& decl) {
     llvm::cast<BasicType>(decl.getType().getBase())->setDecl(&decl);
-    addToSymbolTableWithName(decl, decl.getName());
+    addToSymbolTableWithName(decl, Identifier(decl.getName()));
 }
 
 void Module::addToSymbolTable(VarDecl& decl) {
-    addToSymbolTableWithName(decl, decl.getName());
+    addToSymbolTableWithName(decl, Identifier(decl.getName()));
 }
 
 void Module::addToSymbolTable(Decl* decl) {
-    getSymbolTable().add(decl->getName(), decl);
+    getSymbolTable().add(Identifier(decl->getName()), decl);
 
     if (auto* typeDecl = llvm::dyn_cast<TypeDecl>(decl)) {
         llvm::cast<BasicType>(*typeDecl->getType()).setDecl(typeDecl);
     }
 }
 
-void Module::addIdentifierReplacement(llvm::StringRef source, llvm::StringRef target) {
+void Module::addToSymbolTable(const SourceFile& sourceFile) {
+    for (auto* decl : sourceFile.getTopLevelDecls()) {
+        switch (decl->getKind()) {
+            case DeclKind::FunctionDecl:
+                addToSymbolTable(*llvm::cast<FunctionDecl>(decl));
+                break;
+            case DeclKind::FunctionTemplate:
+                addToSymbolTable(*llvm::cast<FunctionTemplate>(decl));
+                break;
+            case DeclKind::TypeDecl:
+                addToSymbolTable(*llvm::cast<TypeDecl>(decl));
+                break;
+            case DeclKind::TypeTemplate:
+                addToSymbolTable(*llvm::cast<TypeTemplate>(decl));
+                break;
+            case DeclKind::EnumDecl:
+                addToSymbolTable(*llvm::cast<EnumDecl>(decl));
+                break;
+            case DeclKind::VarDecl:
+                addToSymbolTable(*llvm::cast<VarDecl>(decl));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void Module::addIdentifierReplacement(Identifier source, Identifier target) {
     ASSERT(!target.empty());
     getSymbolTable().addIdentifierReplacement(source, target);
 }
 
-Scope::Scope(Decl* parent, SymbolTable* symbolTable) : parent(parent), symbolTable(symbolTable) {
+Scope::Scope(Decl* parent, SymbolTable* symbolTable) : parent(parent), symbolTable(symbolTable), undoLogSize(0) {
     symbolTable->pushScope(*this);
 }
 
 Scope::~Scope() {
-    symbolTable->popScope();
+    symbolTable->popScope(*this);
+}
+
+void SymbolTable::add(Identifier name, Decl* decl) {
+    size_t scopeDepth = scopes.size() - 1;
+    if (scopeDepth == 0) {
+        addGlobal(name, decl);
+        return;
+    }
+
+    auto& chain = bindings[name];
+
+    if (chain.empty() || chain.back()->scopeDepth != scopeDepth) {
+        undoLog.push_back(Binding { name, scopeDepth, {} });
+        chain.push_back(&undoLog.back());
+    }
+
+    chain.back()->decls.push_back(decl);
+}
+
+void SymbolTable::addGlobal(Identifier name, Decl* decl) {
+    auto& chain = bindings[name];
+
+    if (chain.empty() || chain.front()->scopeDepth != 0) {
+        globalBindings.push_back(Binding { name, 0, {} });
+        chain.insert(chain.begin(), &globalBindings.back());
+    }
+
+    chain.front()->decls.push_back(decl);
+}
+
+void SymbolTable::pushScope(Scope& scope) {
+    scope.undoLogSize = undoLog.size();
+    scopes.push_back(&scope);
+}
+
+void SymbolTable::popScope(Scope& scope) {
+    ASSERT(scopes.back() == &scope);
+
+    while (undoLog.size() > scope.undoLogSize) {
+        auto& chain = bindings.find(undoLog.back().name)->second;
+        ASSERT(chain.back() == &undoLog.back() && chain.back()->scopeDepth == scopes.size() - 1);
+        chain.pop_back();
+        undoLog.pop_back();
+    }
+
+    scopes.pop_back();
 }
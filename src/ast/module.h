@@ -1,14 +1,18 @@
 #pragma once
 
+#include <deque>
 #include <string>
 #include <vector>
 #pragma warning(push, 0)
 #include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringMap.h>
 #include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/TinyPtrVector.h>
 #pragma warning(pop)
 #include "decl.h"
+#include "identifier.h"
 
 namespace cx {
 
@@ -37,46 +41,56 @@ private:
     std::vector<Module*> importedModules;
 };
 
+/// A lexical scope in a symbol table, active from its construction until its destruction. Scopes must be destroyed in the
+/// reverse order of their construction.
 struct Scope {
     Decl* parent;
     SymbolTable* symbolTable;
-    llvm::StringMap<std::vector<Decl*>> decls;
+    size_t undoLogSize; ///< The size of the symbol table's undo log when this scope was entered.
 
     Scope(Decl* parent, SymbolTable* symbolTable);
     ~Scope();
 };
 
+/// Maps names to decls. Instead of a separate map per scope, a single map holds the chain of bindings of each name, from the
+/// outermost scope to the innermost one, so a lookup is a single hash probe regardless of the nesting depth. Entering a scope
+/// allocates nothing; leaving it pops the bindings recorded in the undo log since the scope was entered. The bindings themselves
+/// are stored outside the map, so that binding other names doesn't move them.
 struct SymbolTable {
     SymbolTable() : globalScope(nullptr, this) {}
     Scope& getCurrentScope() { return *scopes.back(); }
-    void add(llvm::StringRef name, Decl* decl) { scopes.back()->decls[name].push_back(decl); }
-    void addGlobal(llvm::StringRef name, Decl* decl) { scopes.front()->decls[name].push_back(decl); }
-    void addIdentifierReplacement(llvm::StringRef name, llvm::StringRef replacement) { identifierReplacements.try_emplace(name, replacement); }
-
-    llvm::ArrayRef<Decl*> find(llvm::StringRef name) const {
-        auto realName = applyIdentifierReplacements(name);
-        for (auto& scope : llvm::reverse(scopes)) {
-            auto it = scope->decls.find(realName);
-            if (it != scope->decls.end()) return it->second;
-        }
-        return {};
+    void add(Identifier name, Decl* decl);
+    void addGlobal(Identifier name, Decl* decl);
+    void addIdentifierReplacement(Identifier name, Identifier replacement) { identifierReplacements.try_emplace(name, replacement); }
+
+    /// Returns the decls with the given name in the innermost scope that has any. The returned array is only invalidated by adding
+    /// another decl with the same name to the same scope, or by leaving the scope.
+    llvm::ArrayRef<Decl*> find(Identifier name) const {
+        auto it = bindings.find(applyIdentifierReplacements(name));
+        if (it == bindings.end() || it->second.empty()) return {};
+        return it->second.back()->decls;
     }
 
-    Decl* findOne(llvm::StringRef name) const {
+    /// Looks up a name given as a string without interning it, since nothing can be bound to a name that hasn't been interned.
+    llvm::ArrayRef<Decl*> find(llvm::StringRef name) const { return find(Identifier::find(name)); }
+
+    Decl* findOne(Identifier name) const {
         auto results = find(name);
         if (results.empty()) return nullptr;
         ASSERT(results.size() == 1);
         return results.front();
     }
 
-    llvm::ArrayRef<Decl*> findInCurrentScope(llvm::StringRef name) const {
-        if (!scopes.empty()) {
-            auto it = scopes.back()->decls.find(applyIdentifierReplacements(name));
-            if (it != scopes.back()->decls.end()) return it->second;
-        }
-        return {};
+    Decl* findOne(llvm::StringRef name) const { return findOne(Identifier::find(name)); }
+
+    llvm::ArrayRef<Decl*> findInCurrentScope(Identifier name) const {
+        auto it = bindings.find(applyIdentifierReplacements(name));
+        if (it == bindings.end() || it->second.empty() || it->second.back()->scopeDepth != scopes.size() - 1) return {};
+        return it->second.back()->decls;
     }
 
+    llvm::ArrayRef<Decl*> findInCurrentScope(llvm::StringRef name) const { return findInCurrentScope(Identifier::find(name)); }
+
     FunctionDecl* findWithMatchingPrototype(const FunctionDecl& toFind) const {
         for (Decl* decl : find(toFind.getQualifiedName())) {
             if (auto* functionDecl = llvm::dyn_cast<FunctionDecl>(decl)) {
@@ -91,17 +105,18 @@ struct SymbolTable {
 
 private:
     friend struct Scope;
-    void pushScope(Scope& scope) { scopes.push_back(&scope); }
-    void popScope() { scopes.pop_back(); }
+    void pushScope(Scope& scope);
+    void popScope(Scope& scope);
 
     static bool paramsMatch(const ParamDecl& a, const ParamDecl& b) {
         if (a.getType() != b.getType()) return false;
-        if (a.isPublic && b.isPublic && a.getName() != b.getName()) return false;
+        if (a.isPublic && b.isPublic && a.name != b.name) return false;
         return true;
     }
 
-    llvm::StringRef applyIdentifierReplacements(llvm::StringRef name) const {
-        llvm::StringRef initialName = name;
+    Identifier applyIdentifierReplacements(Identifier name) const {
+        if (identifierReplacements.empty()) return name;
+        Identifier initialName = name;
         while (true) {
             auto it = identifierReplacements.find(name);
             if (it == identifierReplacements.end()) return name;
@@ -110,9 +125,23 @@ private:
         }
     }
 
+    /// The decls that a name is bound to in one scope.
+    struct Binding {
+        Identifier name;
+        size_t scopeDepth;
+        llvm::TinyPtrVector<Decl*> decls;
+    };
+
     std::vector<Scope*> scopes;
-    Scope globalScope;
-    llvm::StringMap<std::string> identifierReplacements;
+    /// The bindings of each name, ordered from the outermost scope to the innermost one.
+    llvm::DenseMap<Identifier, llvm::SmallVector<Binding*, 1>> bindings;
+    /// The bindings in the global scope, which live as long as the symbol table.
+    std::deque<Binding> globalBindings;
+    /// The bindings in non-global scopes, in the order they were created. Deques don't move their elements when adding or removing
+    /// them at the ends.
+    std::deque<Binding> undoLog;
+    llvm::DenseMap<Identifier, Identifier> identifierReplacements;
+    Scope globalScope; // Declared last because entering and leaving it accesses the members above.
 };
 
 /// Container for the AST of a whole module, comprised of one or more SourceFiles.
@@ -123,6 +152,10 @@ struct Module {
     llvm::MutableArrayRef<SourceFile> getSourceFiles() { return sourceFiles; }
     llvm::StringRef getName() const { return name; }
     SymbolTable& getSymbolTable() { return symbolTable; }
+    /// For modules imported from C headers, returns the paths of all header files that were parsed.
+    llvm::ArrayRef<std::string> getCHeaderFilePaths() const { return cHeaderFilePaths; }
+    void addCHeaderFilePath(llvm::StringRef path) { cHeaderFilePaths.push_back(path.str()); }
+    bool isCHeaderModule() const { return !cHeaderFilePaths.empty(); }
 
     std::vector<Module*> getImportedModules() const {
         std::vector<Module*> importedModules;
@@ -141,19 +174,22 @@ struct Module {
     void addToSymbolTable(EnumDecl& decl);
     void addToSymbolTable(VarDecl& decl);
     void addToSymbolTable(Decl* decl);
-    void addIdentifierReplacement(llvm::StringRef source, llvm::StringRef target);
+    /// Adds the top-level declarations of the given source file to the symbol table, reporting redefinitions.
+    void addToSymbolTable(const SourceFile& sourceFile);
+    void addIdentifierReplacement(Identifier source, Identifier target);
 
     static std::vector<Module*> getAllImportedModules();
     static llvm::StringMap<Module*>& getAllImportedModulesMap() { return allImportedModules; }
     static Module* getStdlibModule();
 
 private:
-    void addToSymbolTableWithName(Decl& decl, llvm::StringRef name);
+    void addToSymbolTableWithName(Decl& decl, Identifier name);
 
 private:
     std::string name;
     std::vector<SourceFile> sourceFiles;
     SymbolTable symbolTable;
+    std::vector<std::string> cHeaderFilePaths;
     static llvm::StringMap<Module*> allImportedModules;
 };
 
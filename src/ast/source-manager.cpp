@@ -0,0 +1,147 @@
+#include "source-manager.h"
+#include <algorithm>
+#include <limits>
+#pragma warning(push, 0)
+#include <llvm/Support/FileSystem.h>
+#pragma warning(pop)
+#include "../support/utility.h"
+
+using namespace cx;
+
+SourceManager& SourceManager::get() {
+    static SourceManager sourceManager;
+    return sourceManager;
+}
+
+llvm::ErrorOr<FileID> SourceManager::loadFile(llvm::StringRef path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = fileIDsByPath.find(path);
+    if (it != fileIDsByPath.end()) return it->second;
+
+    // MemoryBuffer memory-maps the file when it's large enough for that to pay off.
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) return buffer.getError();
+    auto size = (*buffer)->getBufferSize();
+    return addFileLocked(path, size, std::move(*buffer));
+}
+
+llvm::ErrorOr<FileID> SourceManager::reserveFile(llvm::StringRef path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = fileIDsByPath.find(path);
+    if (it != fileIDsByPath.end()) return it->second;
+
+    uint64_t size;
+    if (auto error = llvm::sys::fs::file_size(path, size)) return error;
+    return addFileLocked(path, size, nullptr);
+}
+
+llvm::ErrorOr<FileID> SourceManager::addFileLocked(llvm::StringRef path, uint64_t size, std::unique_ptr<llvm::MemoryBuffer> buffer) {
+    // Reserve one extra offset for the end-of-file location, so that it isn't mistaken for the start of the next file.
+    if (size >= std::numeric_limits<uint32_t>::max() - nextStartOffset) return std::make_error_code(std::errc::value_too_large);
+    uint32_t startOffset = nextStartOffset;
+    nextStartOffset += uint32_t(size) + 1;
+
+    files.push_back({ pathSaver.save(path).data(), std::move(buffer), startOffset, uint32_t(size), {} });
+    FileID fileID = FileID(files.size());
+    fileIDsByPath.try_emplace(path, fileID);
+    return fileID;
+}
+
+void SourceManager::forgetLoadedFilePaths() {
+    std::lock_guard<std::mutex> lock(mutex);
+    fileIDsByPath.clear();
+}
+
+SourceManager::File& SourceManager::getFileLocked(FileID file) {
+    ASSERT(file > 0 && file <= files.size());
+    return files[file - 1];
+}
+
+llvm::StringRef SourceManager::getContentsLocked(File& file) {
+    if (!file.buffer) {
+        auto buffer = llvm::MemoryBuffer::getFile(file.path);
+        if (!buffer) {
+            // The file has been removed since it was reserved. Its locations still decode to the file path.
+            file.buffer = llvm::MemoryBuffer::getMemBuffer("", file.path);
+        } else if ((*buffer)->getBufferSize() > file.size) {
+            // The file has grown since it was reserved. Only the reserved part can be referred to by locations.
+            file.buffer = llvm::MemoryBuffer::getMemBufferCopy((*buffer)->getBuffer().take_front(file.size), file.path);
+        } else {
+            file.buffer = std::move(*buffer);
+        }
+    }
+    return file.buffer->getBuffer();
+}
+
+llvm::StringRef SourceManager::getContents(FileID file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return getContentsLocked(getFileLocked(file));
+}
+
+const char* SourceManager::getFilePath(FileID file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return getFileLocked(file).path;
+}
+
+SourceLocation SourceManager::getStartLocation(FileID file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return SourceLocation::fromOffset(getFileLocked(file).startOffset);
+}
+
+SourceLocation SourceManager::getLocation(FileID fileID, unsigned line, unsigned column) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& file = getFileLocked(fileID);
+    auto lineOffsets = getLineOffsetsLocked(file);
+    if (line == 0 || line > lineOffsets.size() || column == 0) return SourceLocation();
+    auto offset = std::min<size_t>(lineOffsets[line - 1] + column - 1, file.size);
+    return SourceLocation::fromOffset(file.startOffset + uint32_t(offset));
+}
+
+FileID SourceManager::getFileIDLocked(SourceLocation location) {
+    if (!location.isValid() || location.getOffset() >= nextStartOffset) return 0;
+    // Files are laid out in the order they were loaded, so the file containing the location is the last one starting before it.
+    auto it = std::upper_bound(files.begin(), files.end(), location.getOffset(),
+                               [](uint32_t offset, const File& file) { return offset < file.startOffset; });
+    return FileID(it - files.begin());
+}
+
+FileID SourceManager::getFileID(SourceLocation location) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return getFileIDLocked(location);
+}
+
+DecodedLocation SourceManager::decode(SourceLocation location) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto fileID = getFileIDLocked(location);
+    if (fileID == 0) return { 0, nullptr, 0, 0 };
+
+    auto& file = getFileLocked(fileID);
+    auto offset = location.getOffset() - file.startOffset;
+    auto lineOffsets = getLineOffsetsLocked(file);
+    auto line = unsigned(std::upper_bound(lineOffsets.begin(), lineOffsets.end(), offset) - lineOffsets.begin());
+    auto column = offset - lineOffsets[line - 1] + 1;
+    return { fileID, file.path, line, column };
+}
+
+llvm::ArrayRef<uint32_t> SourceManager::getLineOffsetsLocked(File& file) {
+    if (file.lineOffsets.empty()) {
+        auto contents = getContentsLocked(file);
+        file.lineOffsets.push_back(0);
+        for (size_t offset = 0; (offset = contents.find('\n', offset)) != llvm::StringRef::npos;) {
+            file.lineOffsets.push_back(uint32_t(++offset));
+        }
+    }
+    return file.lineOffsets;
+}
+
+llvm::StringRef SourceManager::getLineContents(FileID fileID, unsigned line) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& file = getFileLocked(fileID);
+    auto lineOffsets = getLineOffsetsLocked(file);
+    if (line == 0 || line > lineOffsets.size()) return "";
+
+    auto lineContents = getContentsLocked(file).substr(lineOffsets[line - 1]);
+    lineContents = lineContents.take_until([](char ch) { return ch == '\n'; });
+    if (lineContents.endswith("\r")) lineContents = lineContents.drop_back();
+    return lineContents;
+}
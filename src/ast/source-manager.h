@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#pragma warning(push, 0)
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/ErrorOr.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/StringSaver.h>
+#pragma warning(pop)
+#include "location.h"
+
+namespace cx {
+
+/// Owns the contents of all source files read by the compiler. Each file is memory-mapped once and stays loaded for the lifetime
+/// of the process, so tokens and AST nodes can refer to its contents without copying them. Each file is also assigned a range of
+/// offsets following the previously loaded file, so that a SourceLocation can identify both the file and the position within it
+/// with a single 32-bit integer. Files that are only referred to by locations, such as imported C headers, can be reserved
+/// instead, in which case their contents are read only when a location in them is decoded. All member functions are thread-safe.
+struct SourceManager {
+    /// Returns the source manager shared by the whole process.
+    static SourceManager& get();
+
+    /// Loads the file at the given path, or returns the ID of the file if it has already been loaded.
+    llvm::ErrorOr<FileID> loadFile(llvm::StringRef path);
+    /// Assigns the file at the given path a range of offsets based on its current size, without reading it, or returns the ID of
+    /// the file if it has already been loaded or reserved. The contents are read the first time they're needed.
+    llvm::ErrorOr<FileID> reserveFile(llvm::StringRef path);
+    /// Makes later loadFile() calls read the files again, e.g. because they may have been edited. The files that have already been
+    /// loaded stay valid, along with their locations, so their memory is only released when the process exits. Only meant for
+    /// short-lived processes, such as the compile server's request handlers.
+    void forgetLoadedFilePaths();
+    /// Returns the null-terminated contents of the file.
+    llvm::StringRef getContents(FileID file);
+    /// Returns the path of the file. The returned string lives as long as the source manager.
+    const char* getFilePath(FileID file);
+    /// Returns the location of the first character of the file. The location of the character at offset N in the file is N
+    /// characters after it, and the location one past the last character is still in the file.
+    SourceLocation getStartLocation(FileID file);
+    /// Returns the location of the given 1-based line and column in the file, or an invalid location if the line doesn't exist.
+    SourceLocation getLocation(FileID file, unsigned line, unsigned column);
+    /// Returns the file containing the location, or 0 if the location is invalid.
+    FileID getFileID(SourceLocation location);
+    /// Computes the file path, line, and column of the location.
+    DecodedLocation decode(SourceLocation location);
+    /// Returns the contents of the given 1-based line without the line terminator, or an empty string if the line doesn't exist.
+    llvm::StringRef getLineContents(FileID file, unsigned line);
+
+private:
+    struct File {
+        /// The null-terminated path of the file, allocated by pathSaver.
+        const char* path;
+        /// The contents of the file, or null if the file was reserved and hasn't been read yet.
+        std::unique_ptr<llvm::MemoryBuffer> buffer;
+        /// The encoded location of the first character of the file.
+        uint32_t startOffset;
+        /// The size of the file when it was loaded or reserved, which determines the range of offsets assigned to it.
+        uint32_t size;
+        /// The offsets at which each line starts, computed on the first lookup of a line in the file.
+        std::vector<uint32_t> lineOffsets;
+    };
+
+    SourceManager() = default;
+    llvm::ErrorOr<FileID> addFileLocked(llvm::StringRef path, uint64_t size, std::unique_ptr<llvm::MemoryBuffer> buffer);
+    File& getFileLocked(FileID file);
+    llvm::StringRef getContentsLocked(File& file);
+    FileID getFileIDLocked(SourceLocation location);
+    llvm::ArrayRef<uint32_t> getLineOffsetsLocked(File& file);
+
+    std::mutex mutex;
+    std::vector<File> files;
+    llvm::StringMap<FileID> fileIDsByPath;
+    llvm::BumpPtrAllocator pathAllocator;
+    llvm::StringSaver pathSaver{ pathAllocator };
+    /// The offset that will be assigned to the next loaded file. Offset 0 is reserved for invalid locations.
+    uint32_t nextStartOffset = 1;
+};
+
+} // namespace cx
@@ -27,7 +27,7 @@ bool Stmt::isContinuable() const {
     }
 }
 
-Stmt* Stmt::instantiate(const llvm::StringMap<Type>& genericArgs) const {
+Stmt* Stmt::instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs) const {
     switch (getKind()) {
         case StmtKind::ReturnStmt: {
             auto* returnStmt = llvm::cast<ReturnStmt>(this);
@@ -101,6 +101,10 @@ Stmt* Stmt::instantiate(const llvm::StringMap<Type>& genericArgs) const {
             auto body = ::instantiate(compoundStmt->getBody(), genericArgs);
             return new CompoundStmt(std::move(body));
         }
+        case StmtKind::ErrorStmt: {
+            auto* errorStmt = llvm::cast<ErrorStmt>(this);
+            return new ErrorStmt(errorStmt->getLocation());
+        }
     }
     llvm_unreachable("all cases handled");
 }
@@ -115,7 +119,7 @@ Stmt* WhileStmt::lower() {
 //     ...
 // }
 Stmt* ForEachStmt::lower(int nestLevel) {
-    auto iteratorVariableName = "__iterator" + (nestLevel > 0 ? std::to_string(nestLevel) : "");
+    Identifier iteratorVariableName("__iterator" + (nestLevel > 0 ? std::to_string(nestLevel) : ""));
 
     Expr* iteratorValue;
     auto* rangeTypeDecl = range->getType().removePointer().getDecl();
@@ -128,18 +132,18 @@ Stmt* ForEachStmt::lower(int nestLevel) {
         iteratorValue = new CallExpr(iteratorMemberExpr, std::vector<NamedValue>(), std::vector<Type>(), location);
     }
 
-    auto iteratorVarDecl = new VarDecl(Type(nullptr, Mutability::Mutable, location), std::string(iteratorVariableName), iteratorValue,
+    auto iteratorVarDecl = new VarDecl(Type(nullptr, Mutability::Mutable, location), iteratorVariableName, iteratorValue,
                                        variable->getParentDecl(), AccessLevel::None, *variable->getModule(), location);
     auto iteratorVarStmt = new VarStmt(iteratorVarDecl);
 
-    auto iteratorVarExpr = new VarExpr(std::string(iteratorVariableName), location);
+    auto iteratorVarExpr = new VarExpr(iteratorVariableName, location);
     auto hasValueMemberExpr = new MemberExpr(iteratorVarExpr, "hasValue", location);
     auto hasValueCallExpr = new CallExpr(hasValueMemberExpr, std::vector<NamedValue>(), std::vector<Type>(), location);
 
-    auto iteratorVarExpr2 = new VarExpr(std::string(iteratorVariableName), location);
+    auto iteratorVarExpr2 = new VarExpr(iteratorVariableName, location);
     auto valueMemberExpr = new MemberExpr(iteratorVarExpr2, "value", location);
     auto valueCallExpr = new CallExpr(valueMemberExpr, std::vector<NamedValue>(), std::vector<Type>(), location);
-    auto loopVariableVarDecl = new VarDecl(variable->getType(), variable->getName().str(), valueCallExpr, variable->getParentDecl(), AccessLevel::None,
+    auto loopVariableVarDecl = new VarDecl(variable->getType(), Identifier(variable->getName()), valueCallExpr, variable->getParentDecl(), AccessLevel::None,
                                            *variable->getModule(), variable->getLocation());
     auto loopVariableVarStmt = new VarStmt(loopVariableVarDecl);
 
@@ -150,7 +154,7 @@ Stmt* ForEachStmt::lower(int nestLevel) {
         forBody.push_back(stmt);
     }
 
-    auto iteratorVarExpr3 = new VarExpr(std::string(iteratorVariableName), location);
+    auto iteratorVarExpr3 = new VarExpr(iteratorVariableName, location);
     auto incrementMemberExpr = new MemberExpr(iteratorVarExpr3, "increment", location);
     auto incrementCallExpr = new CallExpr(incrementMemberExpr, std::vector<NamedValue>(), std::vector<Type>(), location);
     return new ForStmt(iteratorVarStmt, hasValueCallExpr, incrementCallExpr, std::move(forBody), location);
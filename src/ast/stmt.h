@@ -23,6 +23,7 @@ enum class StmtKind {
     BreakStmt,
     ContinueStmt,
     CompoundStmt,
+    ErrorStmt,
 };
 
 struct Stmt {
@@ -40,11 +41,12 @@ struct Stmt {
     bool isBreakStmt() const { return getKind() == StmtKind::BreakStmt; }
     bool isContinueStmt() const { return getKind() == StmtKind::ContinueStmt; }
     bool isCompoundStmt() const { return getKind() == StmtKind::CompoundStmt; }
+    bool isErrorStmt() const { return getKind() == StmtKind::ErrorStmt; }
 
     StmtKind getKind() const { return kind; }
     bool isBreakable() const;
     bool isContinuable() const;
-    Stmt* instantiate(const llvm::StringMap<Type>& genericArgs) const;
+    Stmt* instantiate(const llvm::DenseMap<Identifier, Type>& genericArgs) const;
 
 protected:
     Stmt(StmtKind kind) : kind(kind) {}
@@ -221,4 +223,14 @@ private:
     std::vector<Stmt*> body;
 };
 
+/// Stands in for a statement that contained a syntax error, so that the parser can continue after reporting it.
+struct ErrorStmt : Stmt {
+    ErrorStmt(SourceLocation location) : Stmt(StmtKind::ErrorStmt), location(location) {}
+    SourceLocation getLocation() const { return location; }
+    static bool classof(const Stmt* s) { return s->getKind() == StmtKind::ErrorStmt; }
+
+private:
+    SourceLocation location;
+};
+
 } // namespace cx
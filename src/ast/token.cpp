@@ -71,6 +71,11 @@ Token::Token(Token::Kind kind, SourceLocation location, llvm::StringRef string)
     ASSERT(location.isValid());
 }
 
+cx::Identifier Token::getIdentifier() const {
+    ASSERT(kind == Token::Identifier);
+    return cx::Identifier::getFromOpaqueValue(string.data());
+}
+
 bool cx::isBinaryOperator(Token::Kind tokenKind) {
     switch (tokenKind) {
         case Token::Equal:
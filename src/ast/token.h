@@ -4,11 +4,13 @@
 #pragma warning(push, 0)
 #include <llvm/ADT/StringRef.h>
 #pragma warning(pop)
+#include "../ast/identifier.h"
 #include "../ast/location.h"
 
 namespace llvm {
 class APSInt;
 class APFloat;
+class raw_ostream;
 template<typename T>
 class ArrayRef;
 } // namespace llvm
@@ -115,16 +117,22 @@ struct Token {
     Token::Kind getKind() const { return kind; }
     operator Token::Kind() const { return kind; }
     llvm::StringRef getString() const { return string; }
+    /// Returns the name of an identifier token. The lexer interns the names of identifier tokens, so this doesn't hash it again.
+    cx::Identifier getIdentifier() const;
     SourceLocation getLocation() const { return location; }
     bool is(Token::Kind kind) const { return this->kind == kind; }
     bool is(llvm::ArrayRef<Token::Kind> kinds) const;
+    /// Returns true if this is the first token on its line, i.e. a newline separates it from the previous token.
+    bool isAtStartOfLine() const { return atStartOfLine; }
+    void setAtStartOfLine(bool value) { atStartOfLine = value; }
     llvm::APSInt getIntegerValue() const;
     llvm::APFloat getFloatingPointValue() const;
 
 private:
     Token::Kind kind;
-    llvm::StringRef string; ///< The substring in the source code representing this token.
+    llvm::StringRef string; ///< The substring in the source code representing this token, or its interned name if it's an identifier.
     SourceLocation location;
+    bool atStartOfLine = false;
 };
 
 struct UnaryOperator {
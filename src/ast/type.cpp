@@ -1,8 +1,16 @@
 #include "type.h"
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 #pragma warning(push, 0)
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/Allocator.h>
 #include <llvm/Support/ErrorHandling.h>
 #pragma warning(pop)
 #include "decl.h"
@@ -10,11 +18,9 @@
 
 using namespace cx;
 
-static std::vector<TypeBase*> typeBases;
-
 #define DEFINE_BUILTIN_TYPE_GET_AND_IS(TYPE, NAME) \
     Type Type::get##TYPE(Mutability mutability, SourceLocation location) { \
-        static BasicType type(#NAME, /*genericArgs*/ {}); \
+        static BasicType type(Identifier(#NAME), /*genericArgs*/ {}); \
         return Type(&type, mutability, location); \
     } \
     bool Type::is##TYPE() const { return isBasicType() && getName() == #NAME; }
@@ -86,12 +92,12 @@ bool Type::isEnumType() const {
     return false;
 }
 
-Type Type::resolve(const llvm::StringMap<Type>& replacements) const {
+Type Type::resolve(const llvm::DenseMap<Identifier, Type>& replacements) const {
     if (!typeBase) return Type(nullptr, mutability, location);
 
     switch (getKind()) {
         case TypeKind::BasicType: {
-            auto it = replacements.find(getName());
+            auto it = replacements.find(llvm::cast<BasicType>(typeBase)->getIdentifier());
             if (it != replacements.end()) {
                 // TODO: Handle generic arguments for type placeholders.
                 Type resolved = it->second.withMutability(mutability);
@@ -100,7 +106,7 @@ Type Type::resolve(const llvm::StringMap<Type>& replacements) const {
             }
 
             auto genericArgs = map(getGenericArgs(), [&](Type t) { return t.resolve(replacements); });
-            return BasicType::get(getName(), std::move(genericArgs), mutability, location);
+            return BasicType::get(llvm::cast<BasicType>(typeBase)->getIdentifier(), std::move(genericArgs), mutability, location);
         }
         case TypeKind::ArrayType:
             return ArrayType::get(getElementType().resolve(replacements), getArraySize(), location);
@@ -123,22 +129,183 @@ Type Type::resolve(const llvm::StringMap<Type>& replacements) const {
     llvm_unreachable("all cases handled");
 }
 
+namespace {
+
+/// Interning table that hash-conses type bases on their structure. Each bucket holds the interned type bases with the same
+/// structural hash in creation order, so that lookups return the oldest matching type base. Type bases are allocated from a
+/// bump allocator and live until the compiler exits.
+struct TypeTable {
+    llvm::BumpPtrAllocator allocator;
+    std::unordered_map<size_t, llvm::SmallVector<TypeBase*, 1>> buckets;
+    llvm::DenseMap<const TypeBase*, unsigned> creationIndices;
+    /// The interned types that each type base is a direct component of. Needed to rehash them when a BasicType is renamed.
+    llvm::DenseMap<const TypeBase*, llvm::SmallVector<TypeBase*, 2>> users;
+    std::mutex mutex;
+
+    template<typename T>
+    T* allocate(T&& typeBase) {
+        return new (allocator.Allocate<T>()) T(std::forward<T>(typeBase));
+    }
+};
+
+} // namespace
+
+static TypeTable& getTypeTable() {
+    static TypeTable typeTable;
+    return typeTable;
+}
+
+static llvm::hash_code hashTypeBase(const TypeBase& typeBase, bool& containsUnresolvedType);
+
+/// Hashes the type consistently with operator==, i.e. ignoring the source location.
+static llvm::hash_code hashType(Type type, bool& containsUnresolvedType) {
+    if (!type) return llvm::hash_value(0);
+    return llvm::hash_combine(type.getMutability(), hashTypeBase(*type, containsUnresolvedType));
+}
+
+/// Hashes the type base consistently with Type::equalsIgnoreTopLevelMutable.
+static llvm::hash_code hashTypeBase(const TypeBase& typeBase, bool& containsUnresolvedType) {
+    llvm::hash_code hash = llvm::hash_value(typeBase.getKind());
+
+    switch (typeBase.getKind()) {
+        case TypeKind::BasicType: {
+            auto& basicType = llvm::cast<BasicType>(typeBase);
+            hash = llvm::hash_combine(hash, basicType.getIdentifier().getOpaqueValue());
+            for (Type genericArg : basicType.getGenericArgs()) {
+                hash = llvm::hash_combine(hash, hashType(genericArg, containsUnresolvedType));
+            }
+            return hash;
+        }
+        case TypeKind::ArrayType: {
+            auto& arrayType = llvm::cast<ArrayType>(typeBase);
+            return llvm::hash_combine(hash, hashType(arrayType.getElementType(), containsUnresolvedType), arrayType.getSize());
+        }
+        case TypeKind::TupleType:
+            for (auto& element : llvm::cast<TupleType>(typeBase).getElements()) {
+                hash = llvm::hash_combine(hash, element.name, hashType(element.type, containsUnresolvedType));
+            }
+            return hash;
+        case TypeKind::FunctionType: {
+            auto& functionType = llvm::cast<FunctionType>(typeBase);
+            hash = llvm::hash_combine(hash, hashType(functionType.getReturnType(), containsUnresolvedType));
+            for (Type paramType : functionType.getParamTypes()) {
+                hash = llvm::hash_combine(hash, hashType(paramType, containsUnresolvedType));
+            }
+            return hash;
+        }
+        case TypeKind::PointerType:
+            return llvm::hash_combine(hash, hashType(llvm::cast<PointerType>(typeBase).getPointeeType(), containsUnresolvedType));
+        case TypeKind::UnresolvedType:
+            containsUnresolvedType = true;
+            return hash;
+    }
+    llvm_unreachable("all cases handled");
+}
+
+static size_t hashTypeBase(const TypeBase& typeBase) {
+    bool containsUnresolvedType = false;
+    return hashTypeBase(typeBase, containsUnresolvedType);
+}
+
+template<typename Callback>
+static void forEachComponent(const TypeBase& typeBase, Callback callback) {
+    switch (typeBase.getKind()) {
+        case TypeKind::BasicType:
+            for (Type genericArg : llvm::cast<BasicType>(typeBase).getGenericArgs()) {
+                callback(genericArg);
+            }
+            break;
+        case TypeKind::ArrayType:
+            callback(llvm::cast<ArrayType>(typeBase).getElementType());
+            break;
+        case TypeKind::TupleType:
+            for (auto& element : llvm::cast<TupleType>(typeBase).getElements()) {
+                callback(element.type);
+            }
+            break;
+        case TypeKind::FunctionType:
+            callback(llvm::cast<FunctionType>(typeBase).getReturnType());
+            for (Type paramType : llvm::cast<FunctionType>(typeBase).getParamTypes()) {
+                callback(paramType);
+            }
+            break;
+        case TypeKind::PointerType:
+            callback(llvm::cast<PointerType>(typeBase).getPointeeType());
+            break;
+        case TypeKind::UnresolvedType:
+            break;
+    }
+}
+
 template<typename T>
 static Type getType(T&& typeBase, Mutability mutability, SourceLocation location) {
     Type newType(&typeBase, mutability, location);
+    auto& table = getTypeTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
 
-    for (auto& existingTypeBase : typeBases) {
-        Type existingType(&*existingTypeBase, mutability, location);
+    bool containsUnresolvedType = false;
+    size_t hash = hashTypeBase(typeBase, containsUnresolvedType);
+
+    // Types containing unresolved placeholders never compare equal to any type, so there's no point in interning them.
+    if (containsUnresolvedType) {
+        return Type(table.allocate(std::forward<T>(typeBase)), mutability, location);
+    }
+
+    auto& bucket = table.buckets[hash];
+
+    for (auto* existingTypeBase : bucket) {
+        Type existingType(existingTypeBase, mutability, location);
         if (existingType.equalsIgnoreTopLevelMutable(newType)) {
             return existingType;
         }
     }
 
-    typeBases.push_back(new T(std::forward<T>(typeBase)));
-    return Type(&*typeBases.back(), mutability, location);
+    auto* internedTypeBase = table.allocate(std::forward<T>(typeBase));
+    unsigned creationIndex = table.creationIndices.size();
+    table.creationIndices[internedTypeBase] = creationIndex;
+    bucket.push_back(internedTypeBase);
+    forEachComponent(*internedTypeBase, [&](Type component) {
+        if (component) table.users[component.getBase()].push_back(internedTypeBase);
+    });
+    return Type(internedTypeBase, mutability, location);
+}
+
+void BasicType::setName(std::string&& name) {
+    auto& table = getTypeTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    // The structural hash of this type and of every interned type containing it depend on the name, so they're rehashed.
+    llvm::SmallVector<TypeBase*, 8> affectedTypeBases = { this };
+    llvm::SmallPtrSet<TypeBase*, 8> visited = { this };
+    for (size_t i = 0; i < affectedTypeBases.size(); ++i) {
+        auto it = table.users.find(affectedTypeBases[i]);
+        if (it == table.users.end()) continue;
+        for (auto* user : it->second) {
+            if (visited.insert(user).second) affectedTypeBases.push_back(user);
+        }
+    }
+
+    llvm::erase_if(affectedTypeBases, [&](TypeBase* typeBase) { return !table.creationIndices.count(typeBase); });
+
+    for (auto* typeBase : affectedTypeBases) {
+        auto bucket = table.buckets.find(hashTypeBase(*typeBase));
+        ASSERT(bucket != table.buckets.end());
+        bucket->second.erase(llvm::find(bucket->second, typeBase));
+        if (bucket->second.empty()) table.buckets.erase(bucket);
+    }
+
+    this->name = Identifier(name);
+
+    for (auto* typeBase : affectedTypeBases) {
+        auto& bucket = table.buckets[hashTypeBase(*typeBase)];
+        auto position = llvm::partition_point(bucket, [&](TypeBase* other) {
+            return table.creationIndices.lookup(other) < table.creationIndices.lookup(typeBase);
+        });
+        bucket.insert(position, typeBase);
+    }
 }
 
-Type BasicType::get(llvm::StringRef name, llvm::ArrayRef<Type> genericArgs, Mutability mutability, SourceLocation location) {
+Type BasicType::get(Identifier name, llvm::ArrayRef<Type> genericArgs, Mutability mutability, SourceLocation location) {
     return getType(BasicType(name, genericArgs), mutability, location);
 }
 
@@ -159,7 +326,7 @@ Type PointerType::get(Type pointeeType, Mutability mutability, SourceLocation lo
 }
 
 Type OptionalType::get(Type wrappedType, Mutability mutability, SourceLocation location) {
-    return BasicType::get("Optional", wrappedType, mutability, location);
+    return BasicType::get(Identifier("Optional"), wrappedType, mutability, location);
 }
 
 Type UnresolvedType::get(Mutability mutability, SourceLocation location) {
@@ -188,7 +355,7 @@ std::string cx::getQualifiedTypeName(llvm::StringRef typeName, llvm::ArrayRef<Ty
 }
 
 std::vector<ParamDecl> FunctionType::getParamDecls(SourceLocation location) const {
-    return map(paramTypes, [&](Type paramType) { return ParamDecl(paramType, "", false, location); });
+    return map(paramTypes, [&](Type paramType) { return ParamDecl(paramType, Identifier(), false, location); });
 }
 
 constexpr auto signedInts = { "int", "int8", "int16", "int32", "int64" };
@@ -278,7 +445,8 @@ bool cx::operator==(Type lhs, Type rhs) {
 bool Type::equalsIgnoreTopLevelMutable(Type other) const {
     switch (getKind()) {
         case TypeKind::BasicType:
-            return other.isBasicType() && getName() == other.getName() && getGenericArgs() == other.getGenericArgs();
+            return other.isBasicType() && llvm::cast<BasicType>(typeBase)->getIdentifier() == llvm::cast<BasicType>(other.typeBase)->getIdentifier() &&
+                   getGenericArgs() == other.getGenericArgs();
         case TypeKind::ArrayType:
             return other.isArrayType() && getElementType() == other.getElementType() && getArraySize() == other.getArraySize();
         case TypeKind::TupleType:
@@ -5,11 +5,13 @@
 #include <vector>
 #pragma warning(push, 0)
 #include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/StringMap.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/Casting.h>
 #include <llvm/Support/raw_ostream.h>
 #pragma warning(pop)
+#include "identifier.h"
 #include "../support/utility.h"
 
 namespace cx {
@@ -96,7 +98,7 @@ struct Type {
     bool isUndefined() const;
     bool isNeverType() const { return isBasicType() && getName() == "never"; }
 
-    Type resolve(const llvm::StringMap<Type>& replacements) const;
+    Type resolve(const llvm::DenseMap<Identifier, Type>& replacements) const;
     bool isInteger() const;
     bool isSigned() const;
     bool isUnsigned() const;
@@ -167,24 +169,26 @@ std::string getQualifiedTypeName(llvm::StringRef typeName, llvm::ArrayRef<Type>
 struct BasicType : TypeBase {
     llvm::ArrayRef<Type> getGenericArgs() const { return genericArgs; }
     llvm::StringRef getName() const { return name; }
-    void setName(std::string&& name) { this->name = std::move(name); }
+    Identifier getIdentifier() const { return name; }
+    /// Renames the type, e.g. to replace a C typedef with its underlying type. The type stays interned under the new name.
+    void setName(std::string&& name);
     std::string getQualifiedName() const { return getQualifiedTypeName(name, genericArgs); }
     TypeDecl* getDecl() const { return decl; }
     void setDecl(TypeDecl* decl) { this->decl = NOTNULL(decl); }
-    static Type get(llvm::StringRef name, llvm::ArrayRef<Type> genericArgs, Mutability mutability = Mutability::Mutable,
+    static Type get(Identifier name, llvm::ArrayRef<Type> genericArgs, Mutability mutability = Mutability::Mutable,
                     SourceLocation location = SourceLocation());
     static bool classof(const TypeBase* t) { return t->getKind() == TypeKind::BasicType; }
 
 private:
     friend Type;
-    BasicType(llvm::StringRef name, std::vector<Type>&& genericArgs)
+    BasicType(Identifier name, std::vector<Type>&& genericArgs)
     : TypeBase(TypeKind::BasicType), name(name), genericArgs(std::move(genericArgs)), decl(nullptr) {
         // TODO: Enable this assert.
         // ASSERT(!name.empty());
     }
 
 private:
-    std::string name;
+    Identifier name;
     std::vector<Type> genericArgs;
     TypeDecl* decl;
 };
@@ -0,0 +1,340 @@
+#include "instantiation-folding.h"
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#pragma warning(push, 0)
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/StringMap.h>
+#pragma warning(pop)
+#include "ir.h"
+
+using namespace cx;
+
+static Function* getFoldedFunction(Function* function) {
+    while (function->foldedInto) {
+        function = function->foldedInto;
+    }
+    return function;
+}
+
+namespace {
+
+/// Encodes function bodies as sequences of integers that are equal exactly when the bodies compile to the same machine code.
+/// Values local to the function are encoded by their position in it, types by their layout, and called functions by the
+/// function they've been folded into.
+struct FunctionEncoder {
+    std::vector<uint64_t> encode(Function& function);
+    void encodeInstruction(const Instruction& inst);
+    void encodeOperand(const Value* value);
+    void encodeAPInt(const llvm::APInt& value);
+    unsigned getLayoutID(IRType* type);
+    unsigned getStringID(llvm::StringRef string);
+
+    std::vector<uint64_t> code;
+    Function* currentFunction = nullptr;
+    llvm::DenseMap<const Value*, unsigned> localValueNumbers;
+    llvm::DenseMap<IRType*, unsigned> layoutIDs;
+    std::map<std::vector<uint64_t>, unsigned> layouts;
+    llvm::StringMap<unsigned> strings;
+};
+
+} // namespace
+
+unsigned FunctionEncoder::getStringID(llvm::StringRef string) {
+    return strings.try_emplace(string, unsigned(strings.size())).first->second;
+}
+
+/// Types get the same ID if their values are represented the same way in machine code. All pointers are represented the same,
+/// so types that differ only in the types they point to have the same layout.
+unsigned FunctionEncoder::getLayoutID(IRType* type) {
+    if (!type) return UINT32_MAX;
+
+    auto it = layoutIDs.find(type);
+    if (it != layoutIDs.end()) return it->second;
+
+    std::vector<uint64_t> layout = { uint64_t(type->kind) };
+
+    switch (type->kind) {
+        case IRTypeKind::IRBasicType:
+            layout.push_back(getStringID(type->getName()));
+            break;
+        case IRTypeKind::IRPointerType:
+            break;
+        case IRTypeKind::IRFunctionType:
+            layout.push_back(getLayoutID(type->getReturnType()));
+            for (auto* paramType : type->getParamTypes()) {
+                layout.push_back(getLayoutID(paramType));
+            }
+            break;
+        case IRTypeKind::IRArrayType:
+            layout.push_back(uint64_t(type->getArraySize()));
+            layout.push_back(getLayoutID(type->getElementType()));
+            break;
+        case IRTypeKind::IRStructType:
+            layout.push_back(llvm::cast<IRStructType>(type)->packed);
+            LLVM_FALLTHROUGH;
+        case IRTypeKind::IRUnionType:
+            for (auto* elementType : type->getElements()) {
+                layout.push_back(getLayoutID(elementType));
+            }
+            break;
+    }
+
+    auto id = layouts.try_emplace(std::move(layout), unsigned(layouts.size())).first->second;
+    layoutIDs.try_emplace(type, id);
+    return id;
+}
+
+void FunctionEncoder::encodeAPInt(const llvm::APInt& value) {
+    code.push_back(value.getBitWidth());
+    code.insert(code.end(), value.getRawData(), value.getRawData() + value.getNumWords());
+}
+
+void FunctionEncoder::encodeOperand(const Value* value) {
+    enum : uint64_t { NoOperand, LocalOperand, GlobalOperand };
+
+    if (!value) {
+        code.push_back(NoOperand);
+        return;
+    }
+
+    auto number = localValueNumbers.find(value);
+    if (number != localValueNumbers.end()) {
+        code.push_back(LocalOperand);
+        code.push_back(number->second);
+        return;
+    }
+
+    code.push_back(GlobalOperand + uint64_t(value->kind));
+
+    switch (value->kind) {
+        case ValueKind::Function: {
+            auto* function = const_cast<Function*>(llvm::cast<Function>(value));
+            // Recursive calls are encoded the same in every function, so that identical recursive functions are folded too.
+            code.push_back(function == currentFunction ? 0 : reinterpret_cast<uintptr_t>(getFoldedFunction(function)));
+            break;
+        }
+        case ValueKind::ConstantString:
+            code.push_back(getStringID(llvm::cast<ConstantString>(value)->value));
+            break;
+        case ValueKind::ConstantInt: {
+            auto* constant = llvm::cast<ConstantInt>(value);
+            code.push_back(getLayoutID(constant->type));
+            code.push_back(constant->value.isUnsigned());
+            encodeAPInt(constant->value);
+            break;
+        }
+        case ValueKind::ConstantFP: {
+            auto* constant = llvm::cast<ConstantFP>(value);
+            code.push_back(getLayoutID(constant->type));
+            encodeAPInt(constant->value.bitcastToAPInt());
+            break;
+        }
+        case ValueKind::ConstantBool:
+            code.push_back(llvm::cast<ConstantBool>(value)->value);
+            break;
+        case ValueKind::ConstantNull:
+            code.push_back(getLayoutID(llvm::cast<ConstantNull>(value)->type));
+            break;
+        case ValueKind::Undefined:
+            code.push_back(getLayoutID(llvm::cast<Undefined>(value)->type));
+            break;
+        case ValueKind::SizeofInst:
+            // Sizeof instructions aren't inserted into any block.
+            code.push_back(getLayoutID(llvm::cast<SizeofInst>(value)->type));
+            break;
+        default:
+            // Global variables, and anything else, are only equal to themselves.
+            code.push_back(reinterpret_cast<uintptr_t>(value));
+            break;
+    }
+}
+
+void FunctionEncoder::encodeInstruction(const Instruction& inst) {
+    code.push_back(uint64_t(inst.kind));
+
+    // The types of the values produced by instructions follow from their operands, except for the pointee types that the layout
+    // of pointers doesn't include, so those are encoded explicitly where they matter.
+    switch (inst.kind) {
+        case ValueKind::AllocaInst:
+            code.push_back(getLayoutID(llvm::cast<AllocaInst>(inst).allocatedType));
+            break;
+        case ValueKind::ReturnInst:
+            encodeOperand(llvm::cast<ReturnInst>(inst).value);
+            break;
+        case ValueKind::BranchInst: {
+            auto& branch = llvm::cast<BranchInst>(inst);
+            encodeOperand(branch.destination);
+            encodeOperand(branch.argument);
+            break;
+        }
+        case ValueKind::CondBranchInst: {
+            auto& condBranch = llvm::cast<CondBranchInst>(inst);
+            encodeOperand(condBranch.condition);
+            encodeOperand(condBranch.trueBlock);
+            encodeOperand(condBranch.falseBlock);
+            encodeOperand(condBranch.argument);
+            break;
+        }
+        case ValueKind::SwitchInst: {
+            auto& switchInst = llvm::cast<SwitchInst>(inst);
+            encodeOperand(switchInst.condition);
+            encodeOperand(switchInst.defaultBlock);
+            code.push_back(switchInst.cases.size());
+            for (auto& switchCase : switchInst.cases) {
+                encodeOperand(switchCase.first);
+                encodeOperand(switchCase.second);
+            }
+            break;
+        }
+        case ValueKind::LoadInst:
+            code.push_back(getLayoutID(inst.getType()));
+            encodeOperand(llvm::cast<LoadInst>(inst).value);
+            break;
+        case ValueKind::StoreInst:
+            encodeOperand(llvm::cast<StoreInst>(inst).value);
+            encodeOperand(llvm::cast<StoreInst>(inst).pointer);
+            break;
+        case ValueKind::InsertInst: {
+            auto& insert = llvm::cast<InsertInst>(inst);
+            encodeOperand(insert.aggregate);
+            encodeOperand(insert.value);
+            code.push_back(insert.index);
+            break;
+        }
+        case ValueKind::ExtractInst:
+            encodeOperand(llvm::cast<ExtractInst>(inst).aggregate);
+            code.push_back(llvm::cast<ExtractInst>(inst).index);
+            break;
+        case ValueKind::CallInst: {
+            auto& call = llvm::cast<CallInst>(inst);
+            auto* functionType = call.function->getType();
+            code.push_back(getLayoutID(functionType->isPointerType() ? functionType->getPointee() : functionType));
+            encodeOperand(call.function);
+            code.push_back(call.args.size());
+            for (auto* arg : call.args) {
+                encodeOperand(arg);
+            }
+            break;
+        }
+        case ValueKind::BinaryInst: {
+            auto& binary = llvm::cast<BinaryInst>(inst);
+            code.push_back(uint64_t(binary.op.getKind()));
+            encodeOperand(binary.left);
+            encodeOperand(binary.right);
+            break;
+        }
+        case ValueKind::UnaryInst:
+            code.push_back(uint64_t(llvm::cast<UnaryInst>(inst).op.getKind()));
+            encodeOperand(llvm::cast<UnaryInst>(inst).operand);
+            break;
+        case ValueKind::GEPInst: {
+            auto& gep = llvm::cast<GEPInst>(inst);
+            code.push_back(getLayoutID(gep.pointer->getType()->getPointee()));
+            encodeOperand(gep.pointer);
+            code.push_back(gep.indexes.size());
+            for (auto* index : gep.indexes) {
+                encodeOperand(index);
+            }
+            break;
+        }
+        case ValueKind::ConstGEPInst:
+            code.push_back(getLayoutID(llvm::cast<ConstGEPInst>(inst).pointer->getType()->getPointee()));
+            encodeOperand(llvm::cast<ConstGEPInst>(inst).pointer);
+            code.push_back(uint64_t(llvm::cast<ConstGEPInst>(inst).index));
+            break;
+        case ValueKind::CastInst:
+            code.push_back(getLayoutID(llvm::cast<CastInst>(inst).type));
+            encodeOperand(llvm::cast<CastInst>(inst).value);
+            break;
+        case ValueKind::UnreachableInst:
+            break;
+        case ValueKind::SizeofInst:
+            code.push_back(getLayoutID(llvm::cast<SizeofInst>(inst).type));
+            break;
+        default:
+            llvm_unreachable("invalid instruction kind");
+    }
+}
+
+std::vector<uint64_t> FunctionEncoder::encode(Function& function) {
+    code.clear();
+    currentFunction = &function;
+    localValueNumbers.clear();
+
+    for (auto& param : function.params) {
+        localValueNumbers.try_emplace(&param, localValueNumbers.size());
+    }
+    for (auto* block : function.body) {
+        localValueNumbers.try_emplace(block, localValueNumbers.size());
+        if (block->parameter) localValueNumbers.try_emplace(block->parameter, localValueNumbers.size());
+        for (auto* inst : block->body) {
+            localValueNumbers.try_emplace(inst, localValueNumbers.size());
+        }
+    }
+
+    code.push_back(function.isVariadic);
+    code.push_back(getLayoutID(function.returnType));
+    code.push_back(function.params.size());
+    for (auto& param : function.params) {
+        code.push_back(getLayoutID(param.type));
+    }
+
+    for (auto* block : function.body) {
+        code.push_back(block->parameter ? getLayoutID(block->parameter->type) : UINT64_MAX);
+        code.push_back(block->body.size());
+        for (auto* inst : block->body) {
+            encodeInstruction(*inst);
+        }
+    }
+
+    return std::move(code);
+}
+
+namespace {
+
+struct FunctionCodeHash {
+    size_t operator()(const std::vector<uint64_t>& code) const { return llvm::hash_combine_range(code.begin(), code.end()); }
+};
+
+} // namespace
+
+InstantiationFoldingStatistics cx::foldIdenticalInstantiations(IRModule& module) {
+    InstantiationFoldingStatistics statistics;
+    std::vector<Function*> instantiations;
+
+    for (auto* function : module.functions) {
+        if (function->isInstantiation && !function->isExtern && !function->body.empty()) {
+            instantiations.push_back(function);
+        }
+    }
+
+    statistics.instantiations = instantiations.size();
+    FunctionEncoder encoder;
+    bool foldedAny = true;
+
+    // Folding callees can make their callers identical, so repeat until nothing more is folded.
+    while (foldedAny) {
+        foldedAny = false;
+        std::unordered_map<std::vector<uint64_t>, Function*, FunctionCodeHash> functionsByCode;
+
+        for (auto* function : instantiations) {
+            if (function->foldedInto) continue;
+
+            auto it = functionsByCode.try_emplace(encoder.encode(*function), function).first;
+            if (it->second != function) {
+                function->foldedInto = it->second;
+                statistics.foldedInstantiations++;
+                foldedAny = true;
+            }
+        }
+    }
+
+    for (auto* function : instantiations) {
+        if (function->foldedInto) function->foldedInto = getFoldedFunction(function);
+    }
+
+    return statistics;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+namespace cx {
+
+struct IRModule;
+
+struct InstantiationFoldingStatistics {
+    size_t instantiations = 0;
+    size_t foldedInstantiations = 0;
+};
+
+/// Finds the generic instantiations defined in the module that compile to the same machine code, such as the methods of
+/// List<Foo*> and List<Bar*>, which differ only in the type their pointers point to. All but one function of each such set are
+/// marked as folded into the remaining one, so that they're emitted as aliases of it instead of being compiled separately.
+InstantiationFoldingStatistics foldIdenticalInstantiations(IRModule& module);
+
+} // namespace cx
@@ -15,6 +15,13 @@ BasicBlock::BasicBlock(std::string name, cx::Function* parent) : Value { ValueKi
 
 static std::unordered_map<TypeBase*, IRType*> irTypes = { { nullptr, nullptr } };
 
+/// IR types are cached for the lifetime of the process, so they're allocated from per-thread arenas that are never released.
+template<typename T, typename... Args>
+static T* createIRType(Args&&... args) {
+    static thread_local Arena* arena = new Arena();
+    return arena->create<T>(std::forward<Args>(args)...);
+}
+
 IRType* cx::getIRType(Type astType) {
     auto it = irTypes.find(astType.getBase());
     if (it != irTypes.end()) return it->second;
@@ -24,7 +31,7 @@ IRType* cx::getIRType(Type astType) {
     switch (astType.getKind()) {
         case TypeKind::BasicType: {
             if (astType.isVoid() || Type::isBuiltinScalar(astType.getName())) {
-                irType = new IRBasicType { IRTypeKind::IRBasicType, astType.getName().str() };
+                irType = createIRType<IRBasicType>(IRTypeKind::IRBasicType, astType.getName().str());
             } else if (astType.isOptionalType() && astType.isImplementedAsPointer()) {
                 irType = getIRType(astType.getWrappedType());
             } else if (astType.isEnumType()) {
@@ -32,8 +39,9 @@ IRType* cx::getIRType(Type astType) {
                 auto tagType = getIRType(enumDecl->getTagType());
 
                 if (enumDecl->hasAssociatedValues()) {
-                    auto unionType = new IRUnionType { IRTypeKind::IRUnionType, {}, "" };
-                    irType = new IRStructType { IRTypeKind::IRStructType, { tagType, unionType }, astType.getQualifiedTypeName(), false };
+                    auto unionType = createIRType<IRUnionType>(IRTypeKind::IRUnionType, std::vector<IRType*>(), "");
+                    irType = createIRType<IRStructType>(IRTypeKind::IRStructType, std::vector<IRType*> { tagType, unionType },
+                                                        astType.getQualifiedTypeName(), false);
                     irTypes.emplace(astType.getBase(), irType);
                     auto associatedTypes = map(enumDecl->getCases(), [](const EnumCase& c) { return getIRType(c.getAssociatedType()); });
                     unionType->elementTypes = std::move(associatedTypes);
@@ -42,7 +50,8 @@ IRType* cx::getIRType(Type astType) {
                     irType = tagType;
                 }
             } else if (astType.getDecl()) {
-                auto structType = new IRStructType { IRTypeKind::IRStructType, {}, astType.getQualifiedTypeName(), astType.getDecl()->packed };
+                auto structType = createIRType<IRStructType>(IRTypeKind::IRStructType, std::vector<IRType*>(), astType.getQualifiedTypeName(),
+                                                             astType.getDecl()->packed);
                 irTypes.emplace(astType.getBase(), structType);
                 auto elementTypes = map(astType.getDecl()->getFields(), [](const FieldDecl& f) { return getIRType(f.getType()); });
                 structType->elementTypes = std::move(elementTypes);
@@ -55,7 +64,7 @@ IRType* cx::getIRType(Type astType) {
         case TypeKind::ArrayType: {
             if (astType.isConstantArray()) {
                 auto elementType = getIRType(astType.getElementType());
-                irType = new IRArrayType { IRTypeKind::IRArrayType, elementType, static_cast<int>(astType.getArraySize()) };
+                irType = createIRType<IRArrayType>(IRTypeKind::IRArrayType, elementType, static_cast<int>(astType.getArraySize()));
             } else {
                 ASSERT(astType.isUnsizedArrayPointer());
                 irType = getIRType(astType.getElementType().getPointerTo());
@@ -64,19 +73,19 @@ IRType* cx::getIRType(Type astType) {
         }
         case TypeKind::TupleType: {
             auto elementTypes = map(astType.getTupleElements(), [](const TupleElement& e) { return getIRType(e.type); });
-            irType = new IRStructType { IRTypeKind::IRStructType, std::move(elementTypes), "", false };
+            irType = createIRType<IRStructType>(IRTypeKind::IRStructType, std::move(elementTypes), "", false);
             break;
         }
         case TypeKind::FunctionType: {
             auto returnType = getIRType(astType.getReturnType());
             auto paramTypes = map(astType.getParamTypes(), [](Type t) { return getIRType(t); });
-            auto functionType = new IRFunctionType { IRTypeKind::IRFunctionType, returnType, std::move(paramTypes) };
-            irType = new IRPointerType { IRTypeKind::IRPointerType, functionType };
+            auto functionType = createIRType<IRFunctionType>(IRTypeKind::IRFunctionType, returnType, std::move(paramTypes));
+            irType = createIRType<IRPointerType>(IRTypeKind::IRPointerType, functionType);
             break;
         }
         case TypeKind::PointerType: {
             auto pointeeType = getIRType(astType.getPointee());
-            irType = new IRPointerType { IRTypeKind::IRPointerType, pointeeType };
+            irType = createIRType<IRPointerType>(IRTypeKind::IRPointerType, pointeeType);
             break;
         }
         case TypeKind::UnresolvedType:
@@ -186,7 +195,7 @@ IRType* Value::getType() const {
         case ValueKind::Function: {
             auto function = llvm::cast<Function>(this);
             auto paramTypes = map(function->params, [](auto& p) { return p.type; });
-            return (new IRFunctionType { IRTypeKind::IRFunctionType, function->returnType, std::move(paramTypes) })->getPointerTo();
+            return createIRType<IRFunctionType>(IRTypeKind::IRFunctionType, function->returnType, std::move(paramTypes))->getPointerTo();
         }
         case ValueKind::Parameter:
             return llvm::cast<Parameter>(this)->type;
@@ -614,7 +623,7 @@ int IRType::getArraySize() {
 }
 
 IRType* IRType::getPointerTo() {
-    return new IRPointerType { IRTypeKind::IRPointerType, this };
+    return createIRType<IRPointerType>(IRTypeKind::IRPointerType, this);
 }
 
 llvm::raw_ostream& cx::operator<<(llvm::raw_ostream& stream, IRType* type) {
@@ -5,9 +5,11 @@
 #pragma warning(push, 0)
 #include <llvm/ADT/APFloat.h>
 #include <llvm/ADT/APSInt.h>
+#include <llvm/ADT/StringMap.h>
 #pragma warning(pop)
 #include "../ast/token.h"
 #include "../ast/type.h"
+#include "../support/arena.h"
 
 namespace llvm {
 class StringRef;
@@ -319,6 +321,10 @@ struct Function : Value {
     bool isExtern;
     bool isVariadic;
     SourceLocation location;
+    /// True for functions instantiated from a generic function or a method of a generic type.
+    bool isInstantiation;
+    /// The identical function that this one is emitted as an alias of, or null if this function's body is emitted.
+    Function* foldedInto = nullptr;
 
     static bool classof(const Value* v) { return v->kind == ValueKind::Function; }
 };
@@ -327,6 +333,10 @@ struct GlobalVariable : Value {
     IRType* type;
     Value* value;
     std::string name;
+    /// The symbol name used when the variable must be visible to other object files.
+    std::string mangledName;
+    /// True for variables imported from C headers, which are defined outside of the program's modules.
+    bool isExtern;
 
     static bool classof(const Value* v) { return v->kind == ValueKind::GlobalVariable; }
 };
@@ -372,7 +382,10 @@ struct Undefined : Value {
 struct IRModule {
     std::string name;
     std::vector<Function*> functions;
+    llvm::StringMap<Function*> functionsByMangledName;
     std::vector<GlobalVariable*> globalVariables;
+    /// Owns all values, instructions, and basic blocks of the module.
+    Arena arena;
 
     void print(llvm::raw_ostream& stream) const;
 };
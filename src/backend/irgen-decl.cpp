@@ -3,16 +3,15 @@
 #include <llvm/Support/SaveAndRestore.h>
 #pragma warning(pop)
 #include "../ast/mangle.h"
+#include "../ast/module.h"
 
 using namespace cx;
 
 Function* IRGenerator::getFunction(const FunctionDecl& decl) {
     auto mangledName = mangleFunctionDecl(decl);
 
-    for (auto* function : module->functions) {
-        if (function->mangledName == mangledName) {
-            return function;
-        }
+    if (auto* function = module->functionsByMangledName.lookup(mangledName)) {
+        return function;
     }
 
     auto params = map(decl.getParams(), [](const ParamDecl& p) { return Parameter { ValueKind::Parameter, getIRType(p.getType()), p.getName().str() }; });
@@ -22,24 +21,23 @@ Function* IRGenerator::getFunction(const FunctionDecl& decl) {
     }
 
     auto returnType = getIRType(decl.isMain() ? Type::getInt() : decl.getReturnType());
-    auto function = new Function {
-        ValueKind::Function, mangledName, returnType, std::move(params), {}, decl.isExtern(), decl.isVariadic(), decl.getLocation(),
-    };
+    bool isInstantiation = !decl.getGenericArgs().empty() || (decl.getTypeDecl() && !decl.getTypeDecl()->getGenericArgs().empty());
+    auto function = create<Function>(ValueKind::Function, mangledName, returnType, std::move(params), std::vector<BasicBlock*>(), decl.isExtern(),
+                                     decl.isVariadic(), decl.getLocation(), isInstantiation);
     module->functions.push_back(function);
+    module->functionsByMangledName.try_emplace(mangledName, function);
 
-    for (auto& instantiation : functionInstantiations) {
-        if (instantiation.function->mangledName == mangledName) {
-            return function;
-        }
+    if (functionInstantiations.try_emplace(mangledName, function).second) {
+        pendingFunctionBodies.push_back({ &decl, function });
     }
 
-    functionInstantiations.push_back({ &decl, function });
     return function;
 }
 
 void IRGenerator::emitFunctionBody(const FunctionDecl& decl, Function& function) {
+    ASSERT(!decl.hasLazyBody(), "body of referenced function was not parsed");
     currentFunction = &function;
-    setInsertPoint(new BasicBlock("", &function));
+    setInsertPoint(create<BasicBlock>("", &function));
     beginScope();
 
     auto arg = function.params.begin();
@@ -75,6 +73,9 @@ void IRGenerator::emitFunctionBody(const FunctionDecl& decl, Function& function)
 }
 
 void IRGenerator::emitFunctionDecl(const FunctionDecl& decl) {
+    // Functions whose body the parser skipped and nothing referenced are unused.
+    if (decl.hasLazyBody()) return;
+
     auto function = getFunction(decl);
 
     if (!decl.isExtern() && function->body.empty()) {
@@ -95,7 +96,7 @@ Value* IRGenerator::emitVarDecl(const VarDecl& decl) {
         Value* value = decl.getInitializer() ? emitExpr(*decl.getInitializer()) : nullptr;
 
         if (decl.getType().isMutable()) {
-            value = createGlobalVariable(value, decl.getType(), decl.getName());
+            value = createGlobalVariable(value, decl.getType(), decl.getName(), mangleGlobalVariable(decl), decl.getModule()->isCHeaderModule());
         }
 
         auto it = globalScope().valuesByDecl.try_emplace(&decl, value);
@@ -19,7 +19,7 @@ Value* IRGenerator::emitStringLiteralExpr(const StringLiteralExpr& expr) {
 
     auto* stringPtr = createGlobalStringPtr(expr.getValue());
     auto* size = createConstantInt(Type::getInt(), expr.getValue().size());
-    auto* alloca = createEntryBlockAlloca(BasicType::get("string", {}), "__str");
+    auto* alloca = createEntryBlockAlloca(BasicType::get(Identifier("string"), {}), "__str");
     Function* stringConstructor = nullptr;
 
     for (auto* decl : Module::getStdlibModule()->getSymbolTable().find("string.init")) {
@@ -184,8 +184,8 @@ Value* IRGenerator::emitConstantIncrement(const UnaryExpr& expr, int increment)
 }
 
 Value* IRGenerator::emitLogicalAnd(const Expr& left, const Expr& right) {
-    auto* rhsBlock = new BasicBlock("and.rhs", insertBlock->parent);
-    auto* endBlock = new BasicBlock("and.end");
+    auto* rhsBlock = create<BasicBlock>("and.rhs", insertBlock->parent);
+    auto* endBlock = create<BasicBlock>("and.end");
 
     Value* lhs = emitExpr(left);
     createCondBr(lhs, rhsBlock, endBlock, lhs);
@@ -195,13 +195,13 @@ Value* IRGenerator::emitLogicalAnd(const Expr& left, const Expr& right) {
     createBr(endBlock, rhs);
 
     setInsertPoint(endBlock);
-    endBlock->parameter = new Parameter { ValueKind::Parameter, lhs->getType(), "and" };
+    endBlock->parameter = create<Parameter>(ValueKind::Parameter, lhs->getType(), "and");
     return endBlock->parameter;
 }
 
 Value* IRGenerator::emitLogicalOr(const Expr& left, const Expr& right) {
-    auto* rhsBlock = new BasicBlock("or.rhs", insertBlock->parent);
-    auto* endBlock = new BasicBlock("or.end");
+    auto* rhsBlock = create<BasicBlock>("or.rhs", insertBlock->parent);
+    auto* endBlock = create<BasicBlock>("or.end");
 
     Value* lhs = emitExpr(left);
     createCondBr(lhs, endBlock, rhsBlock, lhs);
@@ -211,7 +211,7 @@ Value* IRGenerator::emitLogicalOr(const Expr& left, const Expr& right) {
     createBr(endBlock, rhs);
 
     setInsertPoint(endBlock);
-    endBlock->parameter = new Parameter { ValueKind::Parameter, lhs->getType(), "or" };
+    endBlock->parameter = create<Parameter>(ValueKind::Parameter, lhs->getType(), "or");
     return endBlock->parameter;
 }
 
@@ -303,13 +303,15 @@ Value* IRGenerator::emitExprForPassing(const Expr& expr, IRType* targetType) {
 void IRGenerator::emitAssert(Value* condition, const Expr* expr, SourceLocation location, llvm::StringRef message) {
     condition = createIsNull(condition, expr, "assert.condition");
     auto* function = insertBlock->parent;
-    auto* failBlock = new BasicBlock("assert.fail", function);
-    auto* successBlock = new BasicBlock("assert.success", function);
+    auto* failBlock = create<BasicBlock>("assert.fail", function);
+    auto* successBlock = create<BasicBlock>("assert.success", function);
     auto* assertFail = getFunction(*llvm::cast<FunctionDecl>(Module::getStdlibModule()->getSymbolTable().findOne("assertFail")));
     createCondBr(condition, failBlock, successBlock);
     setInsertPoint(failBlock);
-    auto messageAndLocation = llvm::join_items("", message, " at ", llvm::sys::path::filename(location.file), ":", std::to_string(location.line), ":",
-                                               std::to_string(location.column), "\n");
+    auto decodedLocation = location.decode();
+    llvm::StringRef fileName = decodedLocation.filePath ? llvm::sys::path::filename(decodedLocation.filePath) : "";
+    auto messageAndLocation = llvm::join_items("", message, " at ", fileName, ":", std::to_string(decodedLocation.line), ":",
+                                               std::to_string(decodedLocation.column), "\n");
     createCall(assertFail, createGlobalStringPtr(messageAndLocation), nullptr);
     createUnreachable();
     setInsertPoint(successBlock);
@@ -465,7 +467,7 @@ Value* IRGenerator::getArrayLength(const Expr&, Type objectType) {
 }
 
 Value* IRGenerator::getArrayIterator(const Expr& object, Type objectType) {
-    auto type = BasicType::get("ArrayIterator", objectType.getElementType());
+    auto type = BasicType::get(Identifier("ArrayIterator"), objectType.getElementType());
     auto* value = emitExprAsPointer(object);
     auto* elementPtr = createGEP(value, 0);
     auto* size = getArrayLength(object, objectType);
@@ -562,7 +564,7 @@ Value* IRGenerator::emitLambdaExpr(const LambdaExpr& expr) {
     scopes = std::move(scopesBackup);
     if (insertBlockBackup) setInsertPoint(insertBlockBackup);
 
-    VarExpr varExpr(functionDecl->getName().str(), functionDecl->getLocation());
+    VarExpr varExpr(Identifier(functionDecl->getName()), functionDecl->getLocation());
     varExpr.setDecl(functionDecl);
     varExpr.setType(expr.getType());
     return emitVarExpr(varExpr);
@@ -574,9 +576,9 @@ Value* IRGenerator::emitIfExpr(const IfExpr& expr) {
         condition = emitImplicitNullComparison(condition);
     }
     auto* function = currentFunction;
-    auto* thenBlock = new BasicBlock("if.then", function);
-    auto* elseBlock = new BasicBlock("if.else");
-    auto* endIfBlock = new BasicBlock("if.end");
+    auto* thenBlock = create<BasicBlock>("if.then", function);
+    auto* elseBlock = create<BasicBlock>("if.else");
+    auto* endIfBlock = create<BasicBlock>("if.end");
     createCondBr(condition, thenBlock, elseBlock);
 
     setInsertPoint(thenBlock);
@@ -588,7 +590,7 @@ Value* IRGenerator::emitIfExpr(const IfExpr& expr) {
     createBr(endIfBlock, elseValue);
 
     setInsertPoint(endIfBlock);
-    endIfBlock->parameter = new Parameter { ValueKind::Parameter, thenValue->getType(), "if.result" };
+    endIfBlock->parameter = create<Parameter>(ValueKind::Parameter, thenValue->getType(), "if.result");
     return endIfBlock->parameter;
 }
 
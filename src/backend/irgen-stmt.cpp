@@ -41,9 +41,9 @@ void IRGenerator::emitIfStmt(const IfStmt& ifStmt) {
     }
 
     auto* function = insertBlock->parent;
-    auto* thenBlock = new BasicBlock("if.then", function);
-    auto* elseBlock = new BasicBlock("if.else", function);
-    auto* endIfBlock = new BasicBlock("if.end", function);
+    auto* thenBlock = create<BasicBlock>("if.then", function);
+    auto* elseBlock = create<BasicBlock>("if.else", function);
+    auto* endIfBlock = create<BasicBlock>("if.end", function);
     createCondBr(condition, thenBlock, elseBlock);
 
     setInsertPoint(thenBlock);
@@ -65,13 +65,13 @@ void IRGenerator::emitSwitchStmt(const SwitchStmt& switchStmt) {
 
     auto cases = map(switchStmt.getCases(), [&](const SwitchCase& switchCase) {
         auto* value = emitExprOrEnumTag(*switchCase.getValue(), nullptr);
-        auto* block = new BasicBlock("switch.case." + std::to_string(caseIndex++), function);
+        auto* block = create<BasicBlock>("switch.case." + std::to_string(caseIndex++), function);
         return std::make_pair(value, block);
     });
 
     setInsertPoint(insertBlockBackup);
-    auto* defaultBlock = new BasicBlock("switch.default", function);
-    auto* end = new BasicBlock("switch.end", function);
+    auto* defaultBlock = create<BasicBlock>("switch.default", function);
+    auto* end = create<BasicBlock>("switch.end", function);
     breakTargets.push_back(end);
     auto* switchInst = createSwitch(condition, defaultBlock);
 
@@ -106,10 +106,10 @@ void IRGenerator::emitForStmt(const ForStmt& forStmt) {
 
     auto* increment = forStmt.getIncrement();
     auto* function = insertBlock->parent;
-    auto* condition = new BasicBlock("loop.condition", function);
-    auto* body = new BasicBlock("loop.body", function);
-    auto* afterBody = increment ? new BasicBlock("loop.increment", function) : condition;
-    auto* end = new BasicBlock("loop.end", function);
+    auto* condition = create<BasicBlock>("loop.condition", function);
+    auto* body = create<BasicBlock>("loop.body", function);
+    auto* afterBody = increment ? create<BasicBlock>("loop.increment", function) : condition;
+    auto* end = create<BasicBlock>("loop.end", function);
 
     breakTargets.push_back(end);
     continueTargets.push_back(afterBody);
@@ -194,5 +194,8 @@ void IRGenerator::emitStmt(const Stmt& stmt) {
         case StmtKind::CompoundStmt:
             emitCompoundStmt(llvm::cast<CompoundStmt>(stmt));
             break;
+        case StmtKind::ErrorStmt:
+            llvm_unreachable("IR generation shouldn't be reached after a syntax error");
+            break;
     }
 }
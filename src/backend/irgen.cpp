@@ -23,6 +23,12 @@ IRGenerator::IRGenerator() {
     scopes.push_back(IRGenScope(*this));
 }
 
+IRGenerator::~IRGenerator() {
+    for (auto* generatedModule : generatedModules) {
+        delete generatedModule;
+    }
+}
+
 void IRGenerator::setLocalValue(Value* value, const VariableDecl* decl) {
     auto it = scopes.back().valuesByDecl.try_emplace(decl, value);
     ASSERT(it.second);
@@ -124,7 +130,7 @@ void IRGenerator::emitDeferredExprsAndDestructorCallsForReturn() {
 }
 
 AllocaInst* IRGenerator::createEntryBlockAlloca(IRType* type, const llvm::Twine& name) {
-    auto alloca = new AllocaInst { ValueKind::AllocaInst, type, name.str() };
+    auto alloca = create<AllocaInst>(ValueKind::AllocaInst, type, name.str());
     auto& entryBlock = currentFunction->body.front()->body;
     auto insertPosition = entryBlock.end();
 
@@ -146,18 +152,18 @@ AllocaInst* IRGenerator::createTempAlloca(Value* value) {
 }
 
 Value* IRGenerator::createLoad(Value* value, const Expr* expr) {
-    return insertBlock->add(new LoadInst { ValueKind::LoadInst, value, expr, value->getName() + ".load" });
+    return insertBlock->add(create<LoadInst>(ValueKind::LoadInst, value, expr, value->getName() + ".load"));
 }
 
 void IRGenerator::createStore(Value* value, Value* pointer) {
     ASSERT(pointer->getType()->isPointerType());
     ASSERT(pointer->getType()->getPointee()->equals(value->getType()));
-    insertBlock->add(new StoreInst { ValueKind::StoreInst, value, pointer });
+    insertBlock->add(create<StoreInst>(ValueKind::StoreInst, value, pointer));
 }
 
 Value* IRGenerator::createCall(Value* function, llvm::ArrayRef<Value*> args, const CallExpr* expr) {
     ASSERT(function->kind == ValueKind::Function || (function->getType()->isPointerType() && function->getType()->getPointee()->isFunctionType()));
-    return insertBlock->add(new CallInst { ValueKind::CallInst, function, args, expr, "" });
+    return insertBlock->add(create<CallInst>(ValueKind::CallInst, function, args, expr, ""));
 }
 
 Value* IRGenerator::emitAssignmentLHS(const Expr& lhs) {
@@ -235,14 +241,16 @@ IRModule& IRGenerator::emitModule(const Module& sourceModule) {
         }
     }
 
-    for (size_t i = 0; i < functionInstantiations.size(); ++i) {
-        auto& instantiation = functionInstantiations[i];
+    // Emitting a body can register more functions, so the vector may grow during the loop.
+    for (size_t i = 0; i < pendingFunctionBodies.size(); ++i) {
+        auto instantiation = pendingFunctionBodies[i];
 
         if (!instantiation.decl->isExtern() && instantiation.function->body.empty()) {
             currentDecl = instantiation.decl;
             emitFunctionBody(*instantiation.decl, *instantiation.function);
         }
     }
+    pendingFunctionBodies.clear();
 
     generatedModules.push_back(module);
     module = nullptr;
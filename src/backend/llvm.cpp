@@ -1,6 +1,7 @@
 #include "llvm.h"
 #pragma warning(push, 0)
 #include <llvm/ADT/StringSwitch.h>
+#include <llvm/ADT/Triple.h>
 #include <llvm/IR/CFG.h>
 #include <llvm/IR/Verifier.h>
 #pragma warning(pop)
@@ -94,16 +95,20 @@ llvm::Type* LLVMGenerator::getLLVMType(IRType* type) {
     llvm_unreachable("all cases handled");
 }
 
-llvm::Function* LLVMGenerator::getFunction(const Function* function) {
-    if (auto* llvmFunction = module->getFunction(function->mangledName)) return llvmFunction;
-
+llvm::FunctionType* LLVMGenerator::getFunctionType(const Function* function) {
     llvm::SmallVector<llvm::Type*, 16> paramTypes;
     for (auto& param : function->params) {
         paramTypes.emplace_back(getLLVMType(param.type));
     }
 
     auto* returnType = getLLVMType(function->returnType);
-    auto* functionType = llvm::FunctionType::get(returnType, paramTypes, function->isVariadic);
+    return llvm::FunctionType::get(returnType, paramTypes, function->isVariadic);
+}
+
+llvm::Function* LLVMGenerator::getFunction(const Function* function) {
+    if (auto* llvmFunction = module->getFunction(function->mangledName)) return llvmFunction;
+
+    auto* functionType = getFunctionType(function);
     auto* llvmFunction = llvm::Function::Create(functionType, llvm::Function::ExternalLinkage, function->mangledName, &*module);
 
     auto arg = llvmFunction->arg_begin(), argsEnd = llvmFunction->arg_end();
@@ -149,10 +154,45 @@ void LLVMGenerator::codegenFunctionBody(const Function* function, llvm::Function
     }
 }
 
+static bool isAliasee(const llvm::Function& function) {
+    for (auto* user : function.users()) {
+        if (llvm::isa<llvm::GlobalAlias>(user)) return true;
+        if (llvm::isa<llvm::ConstantExpr>(user) && llvm::any_of(user->users(), [](auto* u) { return llvm::isa<llvm::GlobalAlias>(u); })) return true;
+    }
+    return false;
+}
+
+llvm::GlobalValue::LinkageTypes LLVMGenerator::getLinkage(const Function* function) const {
+    // When each module is compiled into its own object file, generic instantiations are weak_odr rather than linkonce_odr because
+    // the other modules only declare them, so the optimizer mustn't discard the definition even if this module doesn't use it.
+    if (function->isInstantiation && options.codegenJobs > 0) return llvm::GlobalValue::WeakODRLinkage;
+    return llvm::GlobalValue::ExternalLinkage;
+}
+
+void LLVMGenerator::codegenFunctionAlias(const Function* function) {
+    auto* functionType = getFunctionType(function);
+    auto* aliasee = llvm::ConstantExpr::getBitCast(getFunction(function->foldedInto), functionType->getPointerTo());
+    auto* alias = llvm::GlobalAlias::create(functionType, 0, getLinkage(function), function->mangledName, aliasee, &*module);
+    generatedValues.emplace(function, alias);
+}
+
 void LLVMGenerator::codegenFunction(const Function* function) {
+    if (function->foldedInto) return;
+
     auto llvmFunction = getFunction(function);
 
     if (!function->isExtern && llvmFunction->empty()) {
+        // Generic instantiations are also defined in a COMDAT so that the linker keeps only one copy if other object files define
+        // them too. Functions that other functions are aliases of are left out of COMDATs, so that the aliases can't be left
+        // pointing to a discarded definition.
+        llvmFunction->setLinkage(getLinkage(function));
+        if (llvmFunction->hasWeakODRLinkage() && !isAliasee(*llvmFunction)) {
+            if (llvm::Triple(options.targetTriple).supportsCOMDAT()) {
+                llvmFunction->setComdat(module->getOrInsertComdat(function->mangledName));
+            }
+        }
+        if (!options.targetCPU.empty()) llvmFunction->addFnAttr("target-cpu", options.targetCPU);
+        if (!options.targetFeatures.empty()) llvmFunction->addFnAttr("target-features", options.targetFeatures);
         codegenFunctionBody(function, llvmFunction);
     }
 
@@ -376,9 +416,22 @@ llvm::Value* LLVMGenerator::codegenBasicBlock(const BasicBlock* block) {
 }
 
 llvm::Value* LLVMGenerator::codegenGlobalVariable(const GlobalVariable* inst) {
-    auto linkage = inst->value ? llvm::GlobalValue::PrivateLinkage : llvm::GlobalValue::ExternalLinkage;
-    auto initializer = inst->value ? llvm::cast<llvm::Constant>(getValue(inst->value)) : nullptr;
-    return new llvm::GlobalVariable(*module, getLLVMType(inst->type), false, linkage, initializer, inst->name);
+    auto* type = getLLVMType(inst->type);
+
+    if (options.codegenJobs == 0) {
+        auto linkage = inst->value ? llvm::GlobalValue::PrivateLinkage : llvm::GlobalValue::ExternalLinkage;
+        auto initializer = inst->value ? llvm::cast<llvm::Constant>(getValue(inst->value)) : nullptr;
+        return new llvm::GlobalVariable(*module, type, false, linkage, initializer, inst->name);
+    }
+
+    // When each module is compiled into its own object file, global variables defined in other modules are only declared here,
+    // and the ones defined in this module must be visible to the other object files. They're named after their module so that
+    // they can't collide with each other or with C symbols, and hidden because nothing outside of the executable uses them.
+    bool isDefinition = inst->value && llvm::is_contained(sourceModule->globalVariables, inst);
+    auto initializer = isDefinition ? llvm::cast<llvm::Constant>(getValue(inst->value)) : nullptr;
+    auto* globalVariable = new llvm::GlobalVariable(*module, type, false, llvm::GlobalValue::ExternalLinkage, initializer, inst->mangledName);
+    if (!inst->isExtern) globalVariable->setVisibility(llvm::GlobalValue::HiddenVisibility);
+    return globalVariable;
 }
 
 llvm::Value* LLVMGenerator::codegenConstantString(const ConstantString* inst) {
@@ -480,6 +533,12 @@ llvm::Value* LLVMGenerator::codegenInst(const Value* value) {
 llvm::Module& LLVMGenerator::codegenModule(const IRModule& sourceModule) {
     ASSERT(!module);
     module = new llvm::Module(sourceModule.name, ctx);
+    this->sourceModule = &sourceModule;
+
+    // Aliases are created first so that references to folded functions don't declare them as separate functions.
+    for (auto* function : sourceModule.functions) {
+        if (function->foldedInto) codegenFunctionAlias(function);
+    }
 
     for (auto* globalVariable : sourceModule.globalVariables) {
         getValue(globalVariable);
@@ -492,5 +551,6 @@ llvm::Module& LLVMGenerator::codegenModule(const IRModule& sourceModule) {
     ASSERT(!llvm::verifyModule(*module, &llvm::errs()));
     generatedModules.push_back(module);
     module = nullptr;
+    this->sourceModule = nullptr;
     return *generatedModules.back();
 }
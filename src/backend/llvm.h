@@ -6,6 +6,7 @@
 #include <llvm/IR/IRBuilder.h>
 #pragma warning(pop)
 #include "ir.h"
+#include "../driver/driver.h"
 
 namespace cx {
 
@@ -17,7 +18,7 @@ struct Function;
 struct BasicBlock;
 
 struct LLVMGenerator {
-    LLVMGenerator() : builder(ctx) {}
+    LLVMGenerator(const CompileOptions& options) : options(options), builder(ctx) {}
     llvm::Module& codegenModule(const IRModule& sourceModule);
     llvm::Value* codegenAlloca(const AllocaInst* inst);
     llvm::Value* codegenReturn(const ReturnInst* inst);
@@ -47,16 +48,21 @@ struct LLVMGenerator {
     llvm::Value* getValue(const Value* value);
     llvm::Value* codegenInst(const Value* value);
     llvm::BasicBlock* getBasicBlock(const BasicBlock* block);
+    llvm::FunctionType* getFunctionType(const Function* function);
     llvm::Function* getFunction(const Function* function);
+    llvm::GlobalValue::LinkageTypes getLinkage(const Function* function) const;
+    void codegenFunctionAlias(const Function* function);
     void codegenFunction(const Function* function);
     void codegenFunctionBody(const Function* function, llvm::Function* llvmFunction);
     llvm::Type* getLLVMType(IRType* type);
     llvm::Type* getBuiltinType(llvm::StringRef name);
     llvm::Type* getStructType(IRStructType* type);
 
+    const CompileOptions& options;
     llvm::LLVMContext ctx;
     llvm::IRBuilder<> builder;
     llvm::Module* module = nullptr;
+    const IRModule* sourceModule = nullptr;
     std::vector<llvm::Module*> generatedModules;
     std::unordered_map<const Value*, llvm::Value*> generatedValues;
     std::unordered_map<IRType*, llvm::StructType*> structs;
@@ -0,0 +1,122 @@
+#include "build-cache.h"
+#pragma warning(push, 0)
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#pragma warning(pop)
+#include "driver.h"
+#include "../ast/module.h"
+#include "../support/statistics.h"
+#include "../support/utility.h"
+
+using namespace cx;
+
+static std::string getDigest(llvm::MD5& hash) {
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+    return result.digest().str().str();
+}
+
+static void hashFile(llvm::MD5& hash, llvm::StringRef filePath) {
+    hash.update(filePath);
+    if (auto buffer = llvm::MemoryBuffer::getFile(filePath)) {
+        hash.update((*buffer)->getBuffer());
+    }
+}
+
+static void hashStrings(llvm::MD5& hash, llvm::ArrayRef<std::string> strings) {
+    for (auto& string : strings) {
+        hash.update(string);
+        hash.update(llvm::StringRef("\0", 1));
+    }
+    hash.update("\n");
+}
+
+BuildCache::BuildCache(llvm::StringRef directory, const CompileOptions& options, const char* argv0, llvm::StringRef objectFileExtension,
+                       bool positionIndependentCode)
+: directory(directory), objectFileExtension(objectFileExtension) {
+    if (auto error = llvm::sys::fs::create_directories(directory)) {
+        ABORT("couldn't create build cache directory '" << directory << "': " << error.message());
+    }
+
+    llvm::MD5 hash;
+
+    // Invalidate the cache whenever the compiler itself changes.
+    auto compilerPath = llvm::sys::fs::getMainExecutable(argv0, (void*) (intptr_t) &getCCompilerPath);
+    llvm::sys::fs::file_status compilerStatus;
+    if (!llvm::sys::fs::status(compilerPath, compilerStatus)) {
+        hash.update(compilerPath);
+        hash.update(std::to_string(compilerStatus.getLastModificationTime().time_since_epoch().count()));
+    }
+
+    hashStrings(hash, options.disabledWarnings);
+    hashStrings(hash, options.importSearchPaths);
+    hashStrings(hash, options.frameworkSearchPaths);
+    hashStrings(hash, options.defines);
+    hashStrings(hash, options.cflags);
+    hashStrings(hash, { std::to_string(int(options.optimizationLevel)), options.targetTriple, options.targetCPU, options.targetFeatures,
+                        objectFileExtension.str(), positionIndependentCode ? "PIC" : "static", options.lazyFunctionBodies ? "lazy" : "eager" });
+    optionsHash = getDigest(hash);
+}
+
+void BuildCache::addModules(llvm::ArrayRef<Module*> modules) {
+    for (auto* module : modules) {
+        llvm::MD5 hash;
+        hash.update(optionsHash);
+        hash.update(keys.empty() ? "" : keys.back());
+        hash.update(module->getName());
+
+        for (auto& sourceFile : module->getSourceFiles()) {
+            hashFile(hash, sourceFile.getFilePath());
+        }
+        for (auto& headerFilePath : module->getCHeaderFilePaths()) {
+            hashFile(hash, headerFilePath);
+        }
+        // Functions with lazy bodies are only emitted if they're used, possibly by other modules.
+        for (auto& sourceFile : module->getSourceFiles()) {
+            for (auto* decl : sourceFile.getTopLevelDecls()) {
+                if (auto* functionDecl = llvm::dyn_cast<FunctionDecl>(decl)) {
+                    if (functionDecl->hasLazyBody()) hashStrings(hash, { functionDecl->getQualifiedName() });
+                }
+            }
+        }
+
+        moduleNames.push_back(module->getName().str());
+        keys.push_back(getDigest(hash));
+        cached.push_back(llvm::sys::fs::exists(getObjectFilePath(keys.size() - 1)));
+    }
+}
+
+std::string BuildCache::getObjectFilePath(size_t moduleIndex) const {
+    llvm::SmallString<128> path(directory);
+    llvm::sys::path::append(path, keys[moduleIndex] + "." + objectFileExtension);
+    return path.str().str();
+}
+
+void BuildCache::store(size_t moduleIndex, llvm::StringRef objectFilePath) const {
+    auto cachedObjectFilePath = getObjectFilePath(moduleIndex);
+
+    // Copy to a unique file first and then rename it, so that concurrent builds never see a partially written object file.
+    llvm::SmallString<128> temporaryPath;
+    llvm::sys::fs::createUniquePath(cachedObjectFilePath + "-%%%%%%%%", temporaryPath, false);
+
+    if (auto error = llvm::sys::fs::copy_file(objectFilePath, temporaryPath)) {
+        ABORT("couldn't copy '" << objectFilePath << "' to '" << temporaryPath << "': " << error.message());
+    }
+    if (auto error = llvm::sys::fs::rename(temporaryPath, cachedObjectFilePath)) {
+        ABORT("couldn't rename '" << temporaryPath << "' to '" << cachedObjectFilePath << "': " << error.message());
+    }
+}
+
+void BuildCache::addStatistics() const {
+    size_t hits = 0;
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        addStatistic("build cache", llvm::Twine(cached[i] ? "hit  " : "miss ") + moduleNames[i] + " (" + keys[i] + ")");
+        if (cached[i]) hits++;
+    }
+
+    addStatistic("build cache", llvm::Twine(hits) + " hits, " + llvm::Twine(keys.size() - hits) + " misses");
+}
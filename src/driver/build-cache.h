@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#pragma warning(push, 0)
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#pragma warning(pop)
+
+namespace cx {
+
+struct CompileOptions;
+struct Module;
+
+/// On-disk cache of the object files generated for each module when modules are compiled separately.
+///
+/// The key of a module is a hash of its source files, the compile options, and the key of the module emitted before it.
+/// Chaining the keys is needed because the contents of a module depend on the modules emitted before it, e.g. a generic
+/// function instantiation is only emitted into the first module that uses it.
+struct BuildCache {
+    BuildCache(llvm::StringRef directory, const CompileOptions& options, const char* argv0, llvm::StringRef objectFileExtension,
+               bool positionIndependentCode);
+    /// Computes the cache keys of the given modules, which must be in the order in which they're emitted, and looks them up.
+    void addModules(llvm::ArrayRef<Module*> modules);
+    bool isCached(size_t moduleIndex) const { return cached[moduleIndex]; }
+    std::string getObjectFilePath(size_t moduleIndex) const;
+    void store(size_t moduleIndex, llvm::StringRef objectFilePath) const;
+    /// Records the hits and misses of the modules for -print-stats.
+    void addStatistics() const;
+
+private:
+    std::string directory;
+    std::string objectFileExtension;
+    std::string optionsHash;
+    std::vector<std::string> moduleNames;
+    std::vector<std::string> keys;
+    std::vector<bool> cached;
+};
+
+} // namespace cx
@@ -1,12 +1,20 @@
 #include "driver.h"
+#include <atomic>
 #include <cstdio>
+#include <map>
 #include <string>
 #include <system_error>
 #include <vector>
 #pragma warning(push, 0)
+#include <llvm/ADT/Optional.h>
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringMap.h>
 #include <llvm/ADT/StringSet.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
@@ -16,16 +24,26 @@
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/Path.h>
 #include <llvm/Support/Process.h>
 #include <llvm/Support/Program.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #pragma warning(pop)
+#include "build-cache.h"
 #include "clang.h"
+#include "server.h"
 #include "../ast/module.h"
+#include "../ast/source-manager.h"
+#include "../backend/instantiation-folding.h"
 #include "../backend/irgen.h"
 #include "../backend/llvm.h"
 #include "../package-manager/manifest.h"
@@ -33,6 +51,8 @@
 #include "../parser/parse.h"
 #include "../sema/null-analyzer.h"
 #include "../sema/typecheck.h"
+#include "../support/statistics.h"
+#include "../support/time-report.h"
 #include "../support/utility.h"
 
 #ifdef _MSC_VER
@@ -45,9 +65,10 @@ using namespace cx;
 namespace cl = llvm::cl;
 
 namespace cx {
-int errors = 0;
+std::atomic<int> errors(0);
 cl::SubCommand build("build", "Build a C* project");
 cl::SubCommand run("run", "Build and run a C* executable");
+cl::SubCommand server("server", "Run a compile server that keeps the standard library loaded between builds");
 cl::list<std::string> inputs(cl::Positional, cl::desc("<input files>"), cl::sub(*cl::AllSubCommands));
 cl::opt<bool> parse("parse", cl::desc("Parse only"));
 cl::opt<bool> typecheck("typecheck", cl::desc("Parse and type-check only"));
@@ -55,7 +76,8 @@ cl::opt<bool> compileOnly("c", cl::desc("Compile only, generating an object file
 cl::opt<bool> printIR("print-ir", cl::desc("Print C* intermediate representation of main module"), cl::sub(build), cl::sub(*cl::TopLevelSubCommand));
 cl::opt<bool> printIRAll("print-ir-all", cl::desc("Print C* intermediate representation of all compiled modules"), cl::sub(build),
                          cl::sub(*cl::TopLevelSubCommand));
-cl::opt<bool> printLLVM("print-llvm", cl::desc("Print LLVM intermediate representation of main module"), cl::sub(build), cl::sub(*cl::TopLevelSubCommand));
+cl::opt<bool> printLLVM("print-llvm", cl::desc("Print LLVM intermediate representation of main module, after optimizing it at the -O level"),
+                        cl::sub(build), cl::sub(*cl::TopLevelSubCommand));
 // TODO: Add -print-llvm-all option.
 cl::opt<bool> emitAssembly("emit-assembly", cl::desc("Emit assembly code"));
 cl::opt<bool> emitBitcode("emit-llvm-bitcode", cl::desc("Emit LLVM bitcode"));
@@ -64,6 +86,43 @@ cl::opt<std::string> specifiedOutputFileName("o", cl::desc("Specify output file
 cl::opt<WarningMode> warningMode(cl::desc("Warning mode:"), cl::sub(*cl::AllSubCommands),
                                  cl::values(clEnumValN(WarningMode::Suppress, "w", "Suppress all warnings"),
                                             clEnumValN(WarningMode::TreatAsErrors, "Werror", "Treat warnings as errors")));
+cl::opt<OptimizationLevel> optimizationLevel(cl::desc("Optimization level:"), cl::init(OptimizationLevel::O0), cl::sub(*cl::AllSubCommands),
+                                            cl::values(clEnumValN(OptimizationLevel::O0, "O0", "No optimizations (default)"),
+                                                       clEnumValN(OptimizationLevel::O1, "O1", "Basic optimizations"),
+                                                       clEnumValN(OptimizationLevel::O2, "O2", "Most optimizations"),
+                                                       clEnumValN(OptimizationLevel::O3, "O3", "All optimizations, including aggressive inlining"),
+                                                       clEnumValN(OptimizationLevel::Os, "Os", "Optimize for code size")));
+cl::opt<std::string> targetTriple("target", cl::desc("Generate code for the given target triple"), cl::value_desc("triple"), cl::sub(*cl::AllSubCommands));
+cl::opt<std::string> targetArch("march", cl::desc("Generate code for the given CPU, or 'native' for the host CPU and its features"), cl::value_desc("cpu-name"),
+                                cl::sub(*cl::AllSubCommands));
+cl::opt<std::string> targetCPU("mcpu", cl::desc("Target a specific CPU type, or 'native' for the host CPU (overrides -march)"), cl::value_desc("cpu-name"),
+                               cl::sub(*cl::AllSubCommands));
+cl::opt<std::string> targetFeatures("mattr", cl::desc("Target specific attributes, e.g. +avx2,-sse4a"), cl::value_desc("a1,+a2,-a3,..."),
+                                    cl::sub(*cl::AllSubCommands));
+cl::opt<unsigned> codegenJobs("j", cl::desc("Compile each module into a separate object file, running N code generation jobs in parallel (0 = one per hardware thread)"),
+                               cl::value_desc("N"), cl::Prefix, cl::sub(*cl::AllSubCommands));
+cl::opt<unsigned> parseJobs("parse-jobs", cl::desc("Parse the source files of each module in N parallel jobs (0 = one per hardware thread)"),
+                            cl::value_desc("N"), cl::init(1), cl::sub(*cl::AllSubCommands));
+cl::opt<bool> lazyFunctionBodies("lazy-function-bodies", cl::desc("Parse the bodies of functions in imported modules only when they're used"),
+                                 cl::sub(*cl::AllSubCommands));
+cl::opt<std::string> buildCacheDirectory("build-cache", cl::desc("Reuse the object files of unchanged modules from the given cache directory"),
+                                        cl::value_desc("directory"), cl::sub(*cl::AllSubCommands));
+cl::opt<std::string> moduleCacheDirectory("module-cache", cl::desc("Cache the declarations imported from C headers in the given directory"),
+                                          cl::value_desc("directory"), cl::sub(*cl::AllSubCommands));
+cl::opt<bool> printStats("print-stats", cl::desc("Print statistics of the compiler's caches and optimizations, such as their hits and misses"),
+                         cl::sub(*cl::AllSubCommands));
+cl::opt<bool> timeReport("ftime-report", cl::desc("Print the time, heap allocations, and peak memory usage of each compiler phase"),
+                         cl::sub(*cl::AllSubCommands));
+cl::opt<std::string> timeTrace("ftime-trace", cl::desc("Write the compiler phases as a Chrome trace event file (default: cx-time-trace.json)"),
+                               cl::value_desc("file"), cl::ValueOptional, cl::sub(*cl::AllSubCommands));
+cl::opt<std::string> serverSocket("server-socket",
+                                  cl::desc("Send the build to the compile server listening on the given Unix socket if there is one "
+                                           "(with 'cx server', listen on the socket)"),
+                                  cl::value_desc("path"), cl::sub(*cl::AllSubCommands));
+cl::opt<std::string> cCompilerIncludePaths("c-compiler-include-paths",
+                                          cl::desc("Use the given system include directories, separated like in PATH, instead of querying "
+                                                   "the C compiler for them"),
+                                          cl::value_desc("paths"), cl::sub(*cl::AllSubCommands));
 cl::list<std::string> disabledWarnings("Wno-", cl::desc("Disable warnings"), cl::value_desc("warning"), cl::Prefix, cl::sub(*cl::AllSubCommands));
 cl::list<std::string> defines("D", cl::desc("Specify defines"), cl::Prefix, cl::sub(*cl::AllSubCommands));
 cl::list<std::string> importSearchPaths("I", cl::desc("Add directory to import search paths"), cl::value_desc("path"), cl::Prefix, cl::sub(*cl::AllSubCommands));
@@ -104,24 +163,114 @@ static void addHeaderSearchPathsFromEnvVar(const char* name) {
     }
 }
 
-static void addHeaderSearchPathsFromCCompilerOutput() {
+/// Runs the C compiler to find out the system include directories it searches.
+static std::vector<std::string> probeCCompilerIncludePaths(llvm::StringRef compilerPath) {
+    std::vector<std::string> paths;
+    if (llvm::sys::path::filename(compilerPath) == "cl.exe") return paths;
+
+    std::string command = "echo | " + compilerPath.str() + " -E -v - 2>&1 | grep '^ /'";
+    std::string output;
+    exec(command.c_str(), output);
+
+    llvm::SmallVector<llvm::StringRef, 8> lines;
+    llvm::SplitString(output, lines, "\n");
+
+    for (auto line : lines) {
+        auto path = line.trim();
+        if (llvm::sys::fs::is_directory(path)) {
+            paths.push_back(path.str());
+        }
+    }
+
+    return paths;
+}
+
+/// Returns the path of the file in the user's cache directory that stores the include directories probed from the given C
+/// compiler, keyed by the compiler's path and modification time and the C flags. Returns an empty string if there's no cache
+/// directory or the compiler can't be found.
+static std::string getCCompilerIncludePathsCacheFile(llvm::StringRef compilerPath) {
+    llvm::SmallString<128> path;
+    llvm::sys::fs::file_status compilerStatus;
+    if (!llvm::sys::path::cache_directory(path) || llvm::sys::fs::status(compilerPath, compilerStatus)) return "";
+
+    llvm::MD5 hash;
+    hash.update(compilerPath);
+    hash.update(std::to_string(compilerStatus.getLastModificationTime().time_since_epoch().count()));
+    for (auto& flag : cflags) {
+        hash.update(flag);
+        hash.update(llvm::StringRef("\0", 1));
+    }
+
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+    llvm::sys::path::append(path, "cx", "c-compiler-include-paths-" + result.digest() + ".txt");
+    return path.str().str();
+}
+
+/// Returns the system include directories of the C compiler, from the on-disk cache if the compiler has been probed before.
+static std::vector<std::string> getCCompilerIncludePaths() {
     auto compilerPath = getCCompilerPath();
-    if (compilerPath.empty()) return;
+    if (compilerPath.empty()) return {};
 
-    if (llvm::sys::path::filename(compilerPath) != "cl.exe") {
-        std::string command = "echo | " + compilerPath + " -E -v - 2>&1 | grep '^ /'";
-        std::string output;
-        exec(command.c_str(), output);
+    auto cacheFilePath = getCCompilerIncludePathsCacheFile(compilerPath);
+    if (cacheFilePath.empty()) return probeCCompilerIncludePaths(compilerPath);
 
+    if (auto buffer = llvm::MemoryBuffer::getFile(cacheFilePath)) {
         llvm::SmallVector<llvm::StringRef, 8> lines;
-        llvm::SplitString(output, lines, "\n");
+        llvm::SplitString((*buffer)->getBuffer(), lines, "\n");
+        std::vector<std::string> paths;
 
         for (auto line : lines) {
-            auto path = line.trim();
-            if (llvm::sys::fs::is_directory(path)) {
-                importSearchPaths.push_back(path.str());
+            if (llvm::sys::fs::is_directory(line)) {
+                paths.push_back(line.str());
+            }
+        }
+
+        return paths;
+    }
+
+    auto paths = probeCCompilerIncludePaths(compilerPath);
+
+    // Caching is best-effort: if the cache directory isn't writable, the compiler is just probed again next time.
+    if (!llvm::sys::fs::create_directories(llvm::sys::path::parent_path(cacheFilePath))) {
+        // Write to a unique file first and then rename it, so that concurrent builds never see a partially written file.
+        llvm::SmallString<128> temporaryPath;
+        llvm::sys::fs::createUniquePath(cacheFilePath + "-%%%%%%%%", temporaryPath, false);
+        std::error_code error;
+        llvm::raw_fd_ostream file(temporaryPath, error);
+
+        if (!error) {
+            for (auto& path : paths) {
+                file << path << '\n';
             }
+            file.close();
+            if (file.has_error() || llvm::sys::fs::rename(temporaryPath, cacheFilePath)) {
+                file.clear_error();
+                llvm::sys::fs::remove(temporaryPath);
+            }
+        }
+    }
+
+    return paths;
+}
+
+static void addHeaderSearchPathsFromCCompilerOutput() {
+    if (cCompilerIncludePaths.getNumOccurrences() > 0) {
+        llvm::SmallVector<llvm::StringRef, 8> paths;
+        llvm::StringRef(cCompilerIncludePaths).split(paths, llvm::sys::EnvPathSeparator, -1, false);
+
+        for (llvm::StringRef path : paths) {
+            importSearchPaths.push_back(path.str());
         }
+        return;
+    }
+
+    // Remembered so that the compile server only looks them up once.
+    static llvm::Optional<std::vector<std::string>> compilerIncludePaths;
+    if (!compilerIncludePaths) compilerIncludePaths = getCCompilerIncludePaths();
+
+    for (auto& path : *compilerIncludePaths) {
+        importSearchPaths.push_back(path);
     }
 }
 
@@ -148,13 +297,78 @@ static void addPredefinedImportSearchPaths(llvm::ArrayRef<std::string> inputFile
     addHeaderSearchPathsFromCCompilerOutput();
 }
 
-static void emitMachineCode(llvm::Module& module, llvm::StringRef fileName, llvm::CodeGenFileType fileType, llvm::Reloc::Model relocModel) {
-    llvm::InitializeNativeTarget();
-    llvm::InitializeNativeTargetAsmPrinter();
-    llvm::InitializeNativeTargetAsmParser();
+static OptimizationLevel getOptimizationLevel(const PackageManifest* manifest) {
+    if (manifest && optimizationLevel.getNumOccurrences() == 0) {
+        return manifest->getOptimizationLevel();
+    }
+    return optimizationLevel;
+}
+
+static unsigned getCodegenJobs() {
+    if (codegenJobs.getNumOccurrences() == 0 && buildCacheDirectory.empty()) return 0;
+    if (codegenJobs == 0) return llvm::heavyweight_hardware_concurrency().compute_thread_count();
+    return codegenJobs;
+}
+
+static std::string getTargetTriple() {
+    return targetTriple.empty() ? llvm::sys::getDefaultTargetTriple() : llvm::Triple::normalize(targetTriple);
+}
+
+/// Returns the CPU name requested with -mcpu or -march, or an empty string if no specific CPU was requested.
+static std::string getTargetCPU() {
+    llvm::StringRef cpu = targetCPU.empty() ? targetArch : targetCPU;
+    if (cpu == "native") return llvm::sys::getHostCPUName().str();
+    return cpu.str();
+}
+
+/// Returns the comma-separated target feature string: the host CPU features if the native CPU was requested, followed by
+/// any features specified with -mattr.
+static std::string getTargetFeatures() {
+    llvm::StringRef cpu = targetCPU.empty() ? targetArch : targetCPU;
+    std::vector<std::string> features;
+
+    if (cpu == "native") {
+        llvm::StringMap<bool> hostFeatures;
+        if (llvm::sys::getHostCPUFeatures(hostFeatures)) {
+            for (auto& feature : hostFeatures) {
+                features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+            }
+            llvm::sort(features);
+        }
+    }
+
+    if (!targetFeatures.empty()) {
+        features.push_back(targetFeatures);
+    }
+
+    return llvm::join(features, ",");
+}
+
+static llvm::CodeGenOpt::Level getCodeGenOptLevel(OptimizationLevel level) {
+    switch (level) {
+        case OptimizationLevel::O0:
+            return llvm::CodeGenOpt::None;
+        case OptimizationLevel::O1:
+            return llvm::CodeGenOpt::Less;
+        case OptimizationLevel::O2:
+        case OptimizationLevel::Os:
+            return llvm::CodeGenOpt::Default;
+        case OptimizationLevel::O3:
+            return llvm::CodeGenOpt::Aggressive;
+    }
+    llvm_unreachable("all cases handled");
+}
+
+static void initializeTargets() {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+    llvm::InitializeAllAsmPrinters();
+    llvm::InitializeAllAsmParsers();
+}
 
-    llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
-    const std::string& targetTriple = triple.str();
+static llvm::TargetMachine* createTargetMachine(llvm::Module& module, llvm::Reloc::Model relocModel, const CompileOptions& compileOptions) {
+    const std::string& targetTriple = compileOptions.targetTriple;
     module.setTargetTriple(targetTriple);
 
     std::string errorMessage;
@@ -162,15 +376,49 @@ static void emitMachineCode(llvm::Module& module, llvm::StringRef fileName, llvm
     if (!target) ABORT(errorMessage);
 
     llvm::TargetOptions options;
-    auto* targetMachine = target->createTargetMachine(targetTriple, "generic", "", options, relocModel);
+    llvm::StringRef cpu = compileOptions.targetCPU.empty() ? "generic" : compileOptions.targetCPU;
+    auto* targetMachine = target->createTargetMachine(targetTriple, cpu, compileOptions.targetFeatures, options, relocModel, llvm::None,
+                                                      getCodeGenOptLevel(compileOptions.optimizationLevel));
     module.setDataLayout(targetMachine->createDataLayout());
+    return targetMachine;
+}
+
+/// Runs the LLVM IR optimization pipeline corresponding to the given optimization level on the module.
+static void optimizeModule(llvm::Module& module, llvm::TargetMachine& targetMachine, OptimizationLevel optimizationLevel) {
+    if (optimizationLevel == OptimizationLevel::O0) return;
+
+    llvm::PassManagerBuilder builder;
+    builder.OptLevel = optimizationLevel == OptimizationLevel::O1 ? 1 : optimizationLevel == OptimizationLevel::O3 ? 3 : 2;
+    builder.SizeLevel = optimizationLevel == OptimizationLevel::Os ? 1 : 0;
+    builder.Inliner = llvm::createFunctionInliningPass(builder.OptLevel, builder.SizeLevel, false);
+    builder.LoopVectorize = builder.OptLevel > 1 && builder.SizeLevel == 0;
+    builder.SLPVectorize = builder.OptLevel > 1 && builder.SizeLevel == 0;
+    builder.LibraryInfo = new llvm::TargetLibraryInfoImpl(llvm::Triple(module.getTargetTriple()));
+    targetMachine.adjustPassManager(builder);
+
+    llvm::legacy::FunctionPassManager functionPassManager(&module);
+    functionPassManager.add(llvm::createTargetTransformInfoWrapperPass(targetMachine.getTargetIRAnalysis()));
+    builder.populateFunctionPassManager(functionPassManager);
+
+    llvm::legacy::PassManager modulePassManager;
+    modulePassManager.add(llvm::createTargetTransformInfoWrapperPass(targetMachine.getTargetIRAnalysis()));
+    builder.populateModulePassManager(modulePassManager);
+
+    functionPassManager.doInitialization();
+    for (auto& function : module) {
+        functionPassManager.run(function);
+    }
+    functionPassManager.doFinalization();
+    modulePassManager.run(module);
+}
 
+static void emitMachineCode(llvm::Module& module, llvm::TargetMachine& targetMachine, llvm::StringRef fileName, llvm::CodeGenFileType fileType) {
     std::error_code error;
     llvm::raw_fd_ostream file(fileName, error, llvm::sys::fs::F_None);
     if (error) ABORT(error.message());
 
     llvm::legacy::PassManager passManager;
-    if (targetMachine->addPassesToEmitFile(passManager, file, nullptr, fileType)) {
+    if (targetMachine.addPassesToEmitFile(passManager, file, nullptr, fileType)) {
         ABORT("TargetMachine can't emit a file of this type");
     }
 
@@ -178,6 +426,62 @@ static void emitMachineCode(llvm::Module& module, llvm::StringRef fileName, llvm
     file.flush();
 }
 
+/// Lowers, optimizes, and compiles each IR module into its own object file, using a separate LLVMContext per module so that
+/// the modules can be processed concurrently. Modules found in the build cache are not recompiled. Returns the paths of the
+/// object files.
+static std::vector<std::string> emitObjectFilesInParallel(llvm::ArrayRef<IRModule*> irModules, const CompileOptions& options,
+                                                          llvm::Reloc::Model relocModel, llvm::StringRef objectFileExtension,
+                                                          const BuildCache* buildCache) {
+    std::vector<std::string> objectFilePaths;
+
+    for (size_t i = 0; i < irModules.size(); ++i) {
+        if (buildCache && buildCache->isCached(i)) {
+            objectFilePaths.push_back(buildCache->getObjectFilePath(i));
+            continue;
+        }
+
+        llvm::SmallString<128> objectFilePath;
+        if (auto error = llvm::sys::fs::createTemporaryFile("cx", objectFileExtension, objectFilePath)) {
+            ABORT(error.message());
+        }
+        objectFilePaths.push_back(objectFilePath.str().str());
+    }
+
+    llvm::ThreadPool threadPool(llvm::hardware_concurrency(options.codegenJobs));
+
+    for (size_t i = 0; i < irModules.size(); ++i) {
+        if (buildCache && buildCache->isCached(i)) continue;
+
+        threadPool.async([&, i] {
+            PhaseTimer jobTimer("Code generation job", irModules[i]->name);
+            LLVMGenerator llvmGenerator(options);
+            std::unique_ptr<llvm::Module> module;
+            {
+                PhaseTimer timer("LLVM IR generation", irModules[i]->name);
+                module.reset(&llvmGenerator.codegenModule(*irModules[i]));
+            }
+            std::unique_ptr<llvm::TargetMachine> targetMachine(createTargetMachine(*module, relocModel, options));
+            {
+                PhaseTimer timer("Optimization", irModules[i]->name);
+                optimizeModule(*module, *targetMachine, options.optimizationLevel);
+            }
+            {
+                PhaseTimer timer("Machine code emission", irModules[i]->name);
+                emitMachineCode(*module, *targetMachine, objectFilePaths[i], llvm::CGFT_ObjectFile);
+            }
+
+            if (buildCache) {
+                buildCache->store(i, objectFilePaths[i]);
+                llvm::sys::fs::remove(objectFilePaths[i]);
+                objectFilePaths[i] = buildCache->getObjectFilePath(i);
+            }
+        });
+    }
+
+    threadPool.wait();
+    return objectFilePaths;
+}
+
 static void emitLLVMBitcode(const llvm::Module& module, llvm::StringRef fileName) {
     std::error_code error;
     llvm::raw_fd_ostream file(fileName, error, llvm::sys::fs::F_None);
@@ -186,6 +490,11 @@ static void emitLLVMBitcode(const llvm::Module& module, llvm::StringRef fileName
     file.flush();
 }
 
+static CompileOptions getCompileOptions(const PackageManifest* manifest) {
+    return { disabledWarnings, importSearchPaths, frameworkSearchPaths, defines, cflags, getOptimizationLevel(manifest), getTargetTriple(), getTargetCPU(),
+             getTargetFeatures(), getCodegenJobs(), moduleCacheDirectory, parseJobs, lazyFunctionBodies };
+}
+
 static int buildExecutable(llvm::ArrayRef<std::string> files, const PackageManifest* manifest, const char* argv0, llvm::StringRef outputDirectory,
                            std::string outputFileName) {
     if (files.empty()) {
@@ -193,38 +502,42 @@ static int buildExecutable(llvm::ArrayRef<std::string> files, const PackageManif
     }
 
     addPredefinedImportSearchPaths(files);
-
-    CompileOptions options = { disabledWarnings, importSearchPaths, frameworkSearchPaths, defines, cflags };
+    auto options = getCompileOptions(manifest);
 
     if (!specifiedOutputFileName.empty()) {
         outputFileName = specifiedOutputFileName;
     }
 
-    Module mainModule("main");
-
-    for (llvm::StringRef filePath : files) {
-        Parser parser(filePath, mainModule, options);
-        parser.parse();
-    }
+    // The main module is never freed, like the imported modules, which stay cached for later builds in this process. The
+    // instantiations stored in their templates and the interned types can refer to the main module's declarations, which refer
+    // back to the module.
+    auto& mainModule = *new Module("main");
+    parseSourceFiles(files, mainModule, options);
 
-    if (parse) return errors ? 1 : 0;
+    // The parser recovers from syntax errors to report all of them, but doesn't typecheck the partial declarations it produces.
+    if (parse || errors) return errors ? 1 : 0;
 
     Typechecker typechecker(options);
     for (auto& importedModule : mainModule.getImportedModules()) {
         typechecker.typecheckModule(*importedModule, nullptr);
     }
     typechecker.typecheckModule(mainModule, manifest);
+    typechecker.addStatistics();
 
     if (errors) return 1;
 
+    auto modules = Module::getAllImportedModules();
+    modules.push_back(&mainModule);
+
     IRGenerator irGenerator;
-    for (auto* importedModule : Module::getAllImportedModules()) {
-        irGenerator.emitModule(*importedModule);
+    for (auto* module : modules) {
+        PhaseTimer timer("IR generation", module->getName());
+        irGenerator.emitModule(*module);
     }
-    irGenerator.emitModule(mainModule);
 
     NullAnalyzer nullAnalyzer;
     for (auto module : irGenerator.generatedModules) {
+        PhaseTimer timer("Null analysis", module->name);
         nullAnalyzer.analyze(module);
     }
 
@@ -241,61 +554,107 @@ static int buildExecutable(llvm::ArrayRef<std::string> files, const PackageManif
         return 0;
     }
 
-    LLVMGenerator llvmGenerator;
-    for (auto* irModule : irGenerator.generatedModules) {
-        llvmGenerator.codegenModule(*irModule);
-    }
-    llvm::Module* llvmModule = llvmGenerator.generatedModules.back();
-
-    if (printLLVM) {
-        llvmModule->setModuleIdentifier("");
-        llvmModule->setSourceFileName("");
-        llvmModule->print(llvm::outs(), nullptr);
-        return 0;
-    }
-
-    llvm::Module linkedModule("", llvmGenerator.ctx);
-    llvm::Linker linker(linkedModule);
-
-    for (auto& module : llvmGenerator.generatedModules) {
-        bool error = linker.linkInModule(std::unique_ptr<llvm::Module>(module));
-        if (error) ABORT("LLVM module linking failed");
-    }
-
-    if (emitBitcode) {
-        emitLLVMBitcode(linkedModule, "output.bc");
-        return 0;
+    if (options.optimizationLevel != OptimizationLevel::O0) {
+        PhaseTimer timer("Instantiation folding");
+        InstantiationFoldingStatistics statistics;
+        for (auto* module : irGenerator.generatedModules) {
+            auto moduleStatistics = foldIdenticalInstantiations(*module);
+            statistics.instantiations += moduleStatistics.instantiations;
+            statistics.foldedInstantiations += moduleStatistics.foldedInstantiations;
+        }
+        addStatistic("instantiation folding", llvm::Twine(statistics.foldedInstantiations) + " of " + llvm::Twine(statistics.instantiations) +
+                                                  " instantiations folded into aliases");
     }
 
     auto ccPath = getCCompilerPath();
     bool msvc = llvm::sys::path::extension(ccPath) == ".exe";
-
-    llvm::SmallString<128> temporaryOutputFilePath;
-    auto* outputFileExtension = emitAssembly ? "s" : msvc ? "obj" : "o";
-    if (auto error = llvm::sys::fs::createTemporaryFile("cx", outputFileExtension, temporaryOutputFilePath)) {
-        ABORT(error.message());
-    }
-
-    auto fileType = emitAssembly ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile;
     if (msvc) emitPositionIndependentCode = true;
     auto relocModel = emitPositionIndependentCode ? llvm::Reloc::Model::PIC_ : llvm::Reloc::Model::Static;
-    emitMachineCode(linkedModule, temporaryOutputFilePath, fileType, relocModel);
+    auto* outputFileExtension = emitAssembly ? "s" : msvc ? "obj" : "o";
+
+    bool treatAsLibrary = mainModule.getSymbolTable().find("main").empty() && !run;
+    if (treatAsLibrary) {
+        compileOnly = true;
+    }
 
     if (!outputDirectory.empty()) {
         auto error = llvm::sys::fs::create_directories(outputDirectory);
         if (error) ABORT(error.message());
     }
 
-    bool treatAsLibrary = mainModule.getSymbolTable().find("main").empty() && !run;
-    if (treatAsLibrary) {
-        compileOnly = true;
-    }
+    initializeTargets();
+    std::vector<std::string> objectFilePaths;
 
-    if (compileOnly || emitAssembly) {
-        llvm::SmallString<128> outputFilePath = outputDirectory;
-        llvm::sys::path::append(outputFilePath, llvm::Twine("output.") + outputFileExtension);
-        renameFile(temporaryOutputFilePath, outputFilePath);
-        return 0;
+    std::unique_ptr<BuildCache> buildCache;
+
+    if (options.codegenJobs > 0 && !printLLVM && !emitBitcode && !emitAssembly && !compileOnly) {
+        if (!buildCacheDirectory.empty()) {
+            buildCache = std::make_unique<BuildCache>(buildCacheDirectory, options, argv0, outputFileExtension, emitPositionIndependentCode);
+            buildCache->addModules(modules);
+            buildCache->addStatistics();
+        }
+        PhaseTimer timer("Parallel code generation");
+        objectFilePaths = emitObjectFilesInParallel(irGenerator.generatedModules, options, relocModel, outputFileExtension, buildCache.get());
+    } else {
+        LLVMGenerator llvmGenerator(options);
+        for (auto* irModule : irGenerator.generatedModules) {
+            PhaseTimer timer("LLVM IR generation", irModule->name);
+            llvmGenerator.codegenModule(*irModule);
+        }
+        llvm::Module* llvmModule = llvmGenerator.generatedModules.back();
+
+        if (printLLVM) {
+            if (options.optimizationLevel != OptimizationLevel::O0) {
+                std::unique_ptr<llvm::TargetMachine> targetMachine(createTargetMachine(*llvmModule, relocModel, options));
+                optimizeModule(*llvmModule, *targetMachine, options.optimizationLevel);
+            }
+            llvmModule->setModuleIdentifier("");
+            llvmModule->setSourceFileName("");
+            llvmModule->print(llvm::outs(), nullptr);
+            return 0;
+        }
+
+        llvm::Module linkedModule("", llvmGenerator.ctx);
+        llvm::Linker linker(linkedModule);
+
+        {
+            PhaseTimer timer("LLVM module linking");
+            for (auto& module : llvmGenerator.generatedModules) {
+                bool error = linker.linkInModule(std::unique_ptr<llvm::Module>(module));
+                if (error) ABORT("LLVM module linking failed");
+            }
+        }
+
+        std::unique_ptr<llvm::TargetMachine> targetMachine(createTargetMachine(linkedModule, relocModel, options));
+        {
+            PhaseTimer timer("Optimization");
+            optimizeModule(linkedModule, *targetMachine, options.optimizationLevel);
+        }
+
+        if (emitBitcode) {
+            emitLLVMBitcode(linkedModule, "output.bc");
+            return 0;
+        }
+
+        llvm::SmallString<128> temporaryOutputFilePath;
+        if (auto error = llvm::sys::fs::createTemporaryFile("cx", outputFileExtension, temporaryOutputFilePath)) {
+            ABORT(error.message());
+        }
+
+        auto fileType = emitAssembly ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile;
+        {
+            PhaseTimer timer("Machine code emission");
+            emitMachineCode(linkedModule, *targetMachine, temporaryOutputFilePath, fileType);
+        }
+
+        if (compileOnly || emitAssembly) {
+            llvm::SmallString<128> outputFilePath = outputDirectory;
+            llvm::sys::path::append(outputFilePath, llvm::Twine("output.") + outputFileExtension);
+            renameFile(temporaryOutputFilePath, outputFilePath);
+            return 0;
+        }
+
+        objectFilePaths.push_back(temporaryOutputFilePath.str().str());
     }
 
     // Link the output.
@@ -303,10 +662,16 @@ static int buildExecutable(llvm::ArrayRef<std::string> files, const PackageManif
     llvm::SmallString<128> temporaryExecutablePath;
     llvm::sys::fs::createUniquePath(msvc ? "cx-%%%%%%%%.exe" : "cx-%%%%%%%%.out", temporaryExecutablePath, true);
 
-    std::vector<const char*> ccArgs = {
-        msvc ? ccPath.c_str() : argv0,
-        temporaryOutputFilePath.c_str(),
-    };
+    std::vector<const char*> ccArgs = { msvc ? ccPath.c_str() : argv0 };
+
+    for (auto& objectFilePath : objectFilePaths) {
+        ccArgs.push_back(objectFilePath.c_str());
+    }
+
+    if (!msvc && !targetTriple.empty()) {
+        ccArgs.push_back("-target");
+        ccArgs.push_back(options.targetTriple.c_str());
+    }
 
     ccArgs.push_back(msvc ? "-Fe:" : "-o");
     ccArgs.push_back(temporaryExecutablePath.c_str());
@@ -324,11 +689,21 @@ static int buildExecutable(llvm::ArrayRef<std::string> files, const PackageManif
     }
 
     std::vector<llvm::StringRef> ccArgStringRefs(ccArgs.begin(), ccArgs.end());
-    int ccExitStatus = msvc ? llvm::sys::ExecuteAndWait(ccArgs[0], ccArgStringRefs) : invokeClang(ccArgs);
-    llvm::sys::fs::remove(temporaryOutputFilePath);
+    int ccExitStatus;
+    {
+        PhaseTimer timer("Linking");
+        ccExitStatus = msvc ? llvm::sys::ExecuteAndWait(ccArgs[0], ccArgStringRefs) : invokeClang(ccArgs);
+    }
+    if (!buildCache) {
+        for (auto& objectFilePath : objectFilePaths) {
+            llvm::sys::fs::remove(objectFilePath);
+        }
+    }
     if (ccExitStatus != 0) return ccExitStatus;
 
     if (run) {
+        // Print the statistics before the program's output, which would otherwise separate them from the compilation.
+        printStatistics(llvm::errs());
         std::string command = (temporaryExecutablePath + " 2>&1").str();
         std::string output;
         int executableExitStatus = exec(command.c_str(), output);
@@ -413,22 +788,146 @@ static void addPlatformCompileOptions() {
 #endif
 }
 
-int main(int argc, const char** argv) {
-    llvm::setBugReportMsg("Please submit a bug report to https://github.com/cx-language/cx/issues and include the crash backtrace.\n");
-    llvm::InitLLVM x(argc, argv);
-    cl::ParseCommandLineOptions(argc, argv, "C* compiler\n");
+/// Runs the compiler with the options parsed from the command line.
+static int runCompiler(const char* argv0) {
     addPlatformCompileOptions();
 
+    bool writeTimeTraceFile = timeTrace.getNumOccurrences() > 0;
+    if (timeReport || writeTimeTraceFile) {
+        enablePhaseTiming();
+    }
+    if (printStats) {
+        enableStatistics();
+    }
+
+    int exitStatus;
+
     if (!inputs.empty()) {
-        return buildExecutable(inputs, nullptr, argv[0], ".", "");
+        exitStatus = buildExecutable(inputs, nullptr, argv0, ".", "");
     } else if (build || run) {
         llvm::SmallString<128> currentPath;
         if (auto error = llvm::sys::fs::current_path(currentPath)) {
             ABORT(error.message());
         }
-        return buildPackage(currentPath, argv[0]);
+        exitStatus = buildPackage(currentPath, argv0);
     } else {
         cl::PrintHelpMessage();
         return 0;
     }
+
+    printStatistics(llvm::errs());
+    if (timeReport) {
+        printTimeReport(llvm::errs());
+    }
+    if (writeTimeTraceFile) {
+        writeTimeTrace(timeTrace.empty() ? "cx-time-trace.json" : timeTrace.getValue());
+    }
+
+    return exitStatus;
+}
+
+/// Returns the options that affect how the standard library is parsed and typechecked. The compile server can only reuse the
+/// standard library it loaded at startup for builds whose options match its own.
+static std::string getStandardLibraryOptionsKey() {
+    std::string key;
+    for (auto* list : { &disabledWarnings, &importSearchPaths, &frameworkSearchPaths, &defines, &cflags }) {
+        for (auto& value : *list) {
+            key += value;
+            key += '\0';
+        }
+        key += '\n';
+    }
+    return key + cCompilerIncludePaths + '\n' + targetTriple + (lazyFunctionBodies ? "lazy" : "eager");
+}
+
+/// Imports and typechecks the standard library and the C headers it imports. Returns false if they have errors, which have been
+/// reported.
+static bool importStandardLibrary(const CompileOptions& options) {
+    int previousErrors = errors;
+    Typechecker typechecker(options);
+    if (auto error = typechecker.importModule(nullptr, nullptr, "std").getError()) {
+        ABORT("couldn't import the standard library: " << error.message());
+    }
+    return errors == previousErrors;
+}
+
+/// Returns the modification times of the source files and directories of the imported modules, and of the C headers they were
+/// imported from, so that the compile server notices when any of them is edited, added, or removed.
+static std::map<std::string, llvm::sys::TimePoint<>> getImportedModuleFileTimes() {
+    std::map<std::string, llvm::sys::TimePoint<>> fileTimes;
+
+    auto addFile = [&](llvm::StringRef path) {
+        llvm::sys::fs::file_status status;
+        // Files that have been removed get the default time point, which differs from the time they were loaded at.
+        fileTimes[path.str()] = llvm::sys::fs::status(path, status) ? llvm::sys::TimePoint<>() : status.getLastModificationTime();
+    };
+
+    for (auto* module : Module::getAllImportedModules()) {
+        for (auto& sourceFile : module->getSourceFiles()) {
+            addFile(sourceFile.getFilePath());
+            addFile(llvm::sys::path::parent_path(sourceFile.getFilePath()));
+        }
+        for (auto& headerFilePath : module->getCHeaderFilePaths()) {
+            addFile(headerFilePath);
+        }
+    }
+
+    return fileTimes;
+}
+
+/// Loads the standard library, the C headers it imports, and the LLVM targets, and then handles build requests sent with
+/// -server-socket in processes forked from this one, so that each build starts with them already loaded. When any of their
+/// files is edited, the server restarts itself to load them again, rather than accumulating the stale copies in memory.
+static int runServer(llvm::ArrayRef<const char*> serverArgs) {
+    if (serverSocket.empty()) ABORT("no socket given to listen on; use -server-socket=<path>");
+
+    auto standardLibraryOptionsKey = getStandardLibraryOptionsKey();
+    addPlatformCompileOptions();
+    addPredefinedImportSearchPaths({});
+    initializeTargets();
+
+    if (!importStandardLibrary(getCompileOptions(nullptr))) return 1;
+    auto standardLibraryFileTimes = getImportedModuleFileTimes();
+    bool standardLibraryIsStale = false;
+
+    auto isStale = [&] {
+        standardLibraryIsStale = getImportedModuleFileTimes() != standardLibraryFileTimes;
+        return standardLibraryIsStale;
+    };
+
+    serveBuildRequests(serverSocket, serverArgs, isStale, [&](llvm::ArrayRef<const char*> args) {
+        cl::ResetAllOptionOccurrences();
+        cl::ParseCommandLineOptions(int(args.size()), args.data(), "C* compiler\n");
+        if (server) ABORT("a compile server can't be started from a build request");
+
+        if (standardLibraryIsStale) {
+            // The server restarts after this request, so only this process needs to read the edited files.
+            Module::getAllImportedModulesMap().clear();
+            SourceManager::get().forgetLoadedFilePaths();
+        } else if (getStandardLibraryOptionsKey() != standardLibraryOptionsKey) {
+            // Import the standard library again with this request's options.
+            Module::getAllImportedModulesMap().clear();
+        }
+
+        return runCompiler(args[0]);
+    });
+    return 0;
+}
+
+int main(int argc, const char** argv) {
+    llvm::setBugReportMsg("Please submit a bug report to https://github.com/cx-language/cx/issues and include the crash backtrace.\n");
+    llvm::InitLLVM x(argc, argv);
+    cl::ParseCommandLineOptions(argc, argv, "C* compiler\n");
+
+    if (server) {
+        return runServer(llvm::makeArrayRef(argv, argc));
+    }
+
+    if (!serverSocket.empty()) {
+        if (auto exitStatus = sendBuildRequest(serverSocket, llvm::makeArrayRef(argv, argc))) {
+            return *exitStatus;
+        }
+    }
+
+    return runCompiler(argv[0]);
 }
@@ -5,12 +5,26 @@
 
 namespace cx {
 
+enum class OptimizationLevel { O0, O1, O2, O3, Os };
+
 struct CompileOptions {
     std::vector<std::string> disabledWarnings;
     std::vector<std::string> importSearchPaths;
     std::vector<std::string> frameworkSearchPaths;
     std::vector<std::string> defines;
     std::vector<std::string> cflags;
+    OptimizationLevel optimizationLevel = OptimizationLevel::O0;
+    std::string targetTriple;
+    std::string targetCPU;
+    std::string targetFeatures;
+    /// If non-zero, each module is compiled into a separate object file using this many parallel jobs.
+    unsigned codegenJobs = 0;
+    /// If non-empty, the declarations imported from C headers are cached in this directory as module interface files.
+    std::string moduleCacheDirectory;
+    /// The number of threads used to parse the source files of a module, or 0 for one per hardware thread.
+    unsigned parseJobs = 1;
+    /// If true, the bodies of non-template functions in imported modules are parsed and typechecked only if they're used.
+    bool lazyFunctionBodies = false;
 };
 
 } // namespace cx
@@ -0,0 +1,251 @@
+#include "server.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#pragma warning(push, 0)
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#pragma warning(pop)
+#include "../support/utility.h"
+
+using namespace cx;
+
+#ifndef _WIN32
+
+// A request consists of one byte carrying the client's standard input, output, and error as SCM_RIGHTS ancillary data,
+// followed by the size of the payload and the payload itself: the client's working directory and command-line arguments,
+// each terminated by a null character. The response is the 32-bit exit status of the request.
+
+static const int forwardedFileDescriptors[] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+
+// Passes the listening socket to the server process that replaces the current one when it restarts.
+static const char listenerFileDescriptorVariable[] = "CX_SERVER_LISTENER_FD";
+
+static sockaddr_un getSocketAddress(llvm::StringRef socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) ABORT("socket path '" << socketPath << "' is too long");
+    memcpy(address.sun_path, socketPath.data(), socketPath.size());
+    return address;
+}
+
+static bool writeAll(int fd, const void* data, size_t size) {
+    auto* bytes = static_cast<const char*>(data);
+
+    while (size > 0) {
+        auto written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += written;
+        size -= size_t(written);
+    }
+
+    return true;
+}
+
+static bool readAll(int fd, void* data, size_t size) {
+    auto* bytes = static_cast<char*>(data);
+
+    while (size > 0) {
+        auto bytesRead = read(fd, bytes, size);
+        if (bytesRead <= 0) {
+            if (bytesRead < 0 && errno == EINTR) continue;
+            return false;
+        }
+        bytes += bytesRead;
+        size -= size_t(bytesRead);
+    }
+
+    return true;
+}
+
+static bool sendFileDescriptors(int socket) {
+    char byte = 0;
+    iovec ioVector = { &byte, 1 };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(forwardedFileDescriptors))] = {};
+    msghdr message = {};
+    message.msg_iov = &ioVector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    auto* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(forwardedFileDescriptors));
+    memcpy(CMSG_DATA(header), forwardedFileDescriptors, sizeof(forwardedFileDescriptors));
+    return sendmsg(socket, &message, 0) == 1;
+}
+
+static bool receiveFileDescriptors(int socket, int (&fileDescriptors)[3]) {
+    char byte;
+    iovec ioVector = { &byte, 1 };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fileDescriptors))] = {};
+    msghdr message = {};
+    message.msg_iov = &ioVector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (recvmsg(socket, &message, 0) != 1) return false;
+
+    auto* header = CMSG_FIRSTHDR(&message);
+    if (!header || header->cmsg_type != SCM_RIGHTS || header->cmsg_len != CMSG_LEN(sizeof(fileDescriptors))) return false;
+    memcpy(fileDescriptors, CMSG_DATA(header), sizeof(fileDescriptors));
+    return true;
+}
+
+/// Handles a request in the child process forked for it. Never returns: if the request handler exits the process itself, e.g.
+/// after a fatal error, the client sees the connection closed without an exit status.
+[[noreturn]] static void handleConnection(int connection, llvm::function_ref<int(llvm::ArrayRef<const char*> args)> handleRequest) {
+    // The server ignores SIGCHLD to have its children reaped automatically, but the request handler waits for its own children.
+    signal(SIGCHLD, SIG_DFL);
+
+    int fileDescriptors[3];
+    uint32_t size;
+    if (!receiveFileDescriptors(connection, fileDescriptors) || !readAll(connection, &size, sizeof(size))) _exit(1);
+    std::string payload(size, '\0');
+    if (!readAll(connection, &payload[0], size)) _exit(1);
+
+    std::vector<const char*> strings;
+    for (size_t i = 0; i < payload.size(); i += strlen(&payload[i]) + 1) {
+        strings.push_back(&payload[i]);
+    }
+    if (strings.size() < 2 || chdir(strings[0]) != 0) _exit(1);
+
+    for (int i = 0; i < 3; ++i) {
+        dup2(fileDescriptors[i], forwardedFileDescriptors[i]);
+        close(fileDescriptors[i]);
+    }
+
+    int32_t exitStatus = handleRequest(llvm::makeArrayRef(strings).drop_front());
+    llvm::outs().flush();
+    llvm::errs().flush();
+    fflush(stdout);
+    fflush(stderr);
+    writeAll(connection, &exitStatus, sizeof(exitStatus));
+    _exit(0);
+}
+
+static int startListening(llvm::StringRef socketPath) {
+    // A restarted server inherits the socket of the server it replaced, so that clients never find the socket closed.
+    if (const char* inheritedListener = getenv(listenerFileDescriptorVariable)) {
+        int listener = atoi(inheritedListener);
+        unsetenv(listenerFileDescriptorVariable);
+        return listener;
+    }
+
+    auto address = getSocketAddress(socketPath);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) ABORT("couldn't create socket: " << strerror(errno));
+    llvm::sys::fs::remove(socketPath);
+
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+        ABORT("couldn't listen on '" << socketPath << "': " << strerror(errno));
+    }
+
+    return listener;
+}
+
+/// Replaces the server process with a new one started with the same arguments, which inherits the listening socket.
+[[noreturn]] static void restart(int listener, llvm::ArrayRef<const char*> serverArgs) {
+    auto executablePath = llvm::sys::fs::getMainExecutable(serverArgs[0], (void*) (intptr_t) &restart);
+    setenv(listenerFileDescriptorVariable, std::to_string(listener).c_str(), 1);
+    std::vector<const char*> args(serverArgs.begin(), serverArgs.end());
+    args.push_back(nullptr);
+    execv(executablePath.c_str(), const_cast<char* const*>(args.data()));
+    ABORT("couldn't restart the compile server: " << strerror(errno));
+}
+
+void cx::serveBuildRequests(llvm::StringRef socketPath, llvm::ArrayRef<const char*> serverArgs, llvm::function_ref<bool()> isStale,
+                            llvm::function_ref<int(llvm::ArrayRef<const char*> args)> handleRequest) {
+    int listener = startListening(socketPath);
+    signal(SIGCHLD, SIG_IGN);
+    llvm::errs() << "cx server: listening on " << socketPath << "\n";
+
+    while (true) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            ABORT("couldn't accept connection on '" << socketPath << "': " << strerror(errno));
+        }
+
+        bool stale = isStale();
+        llvm::errs() << "cx server: handling build request\n";
+
+        // Don't let the child inherit buffered output, which would then be written twice.
+        llvm::outs().flush();
+        llvm::errs().flush();
+        fflush(nullptr);
+
+        if (fork() == 0) {
+            close(listener);
+            handleConnection(connection, handleRequest);
+        }
+
+        // If fork() failed, closing the connection makes the client fail the request.
+        close(connection);
+
+        if (stale) {
+            llvm::errs() << "cx server: restarting\n";
+            llvm::errs().flush();
+            restart(listener, serverArgs);
+        }
+    }
+}
+
+llvm::Optional<int> cx::sendBuildRequest(llvm::StringRef socketPath, llvm::ArrayRef<const char*> args) {
+    auto address = getSocketAddress(socketPath);
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0) return llvm::None;
+
+    if (connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(connection);
+        return llvm::None;
+    }
+
+    llvm::SmallString<128> currentPath;
+    if (auto error = llvm::sys::fs::current_path(currentPath)) ABORT(error.message());
+
+    std::string payload(currentPath.str());
+    payload += '\0';
+    for (auto* arg : args) {
+        payload += arg;
+        payload += '\0';
+    }
+
+    uint32_t size = uint32_t(payload.size());
+    if (!sendFileDescriptors(connection) || !writeAll(connection, &size, sizeof(size)) || !writeAll(connection, payload.data(), payload.size())) {
+        ABORT("couldn't send build request to '" << socketPath << "': " << strerror(errno));
+    }
+
+    int32_t exitStatus;
+    if (!readAll(connection, &exitStatus, sizeof(exitStatus))) exitStatus = 1;
+    close(connection);
+    return int(exitStatus);
+}
+
+#else
+
+void cx::serveBuildRequests(llvm::StringRef, llvm::ArrayRef<const char*>, llvm::function_ref<bool()>,
+                            llvm::function_ref<int(llvm::ArrayRef<const char*> args)>) {
+    ABORT("the compile server is not supported on Windows");
+}
+
+llvm::Optional<int> cx::sendBuildRequest(llvm::StringRef, llvm::ArrayRef<const char*>) {
+    return llvm::None;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+#pragma warning(push, 0)
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/Optional.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringRef.h>
+#pragma warning(pop)
+
+namespace cx {
+
+/// Listens for build requests on the given Unix domain socket until the process is killed. Each request is handled by a child
+/// process forked from the server, which runs handleRequest with the client's command-line arguments in the client's working
+/// directory, with the client's standard streams, and sends the returned exit status back to the client. Because the children
+/// work on copies of the server's memory, everything the server loaded before this call is reused by every request, and no
+/// request can leave behind state that affects the next one.
+///
+/// isStale is called in the server before each child is forked. If it returns true, the server restarts itself with the given
+/// command-line arguments after forking the child, keeping its socket, so that the restarted server loads everything again.
+/// The server logs to standard error when it starts listening and when it handles a request.
+void serveBuildRequests(llvm::StringRef socketPath, llvm::ArrayRef<const char*> serverArgs, llvm::function_ref<bool()> isStale,
+                        llvm::function_ref<int(llvm::ArrayRef<const char*> args)> handleRequest);
+
+/// Sends the command-line arguments to the compile server listening on the given socket, and returns the exit status of the
+/// request once the server has handled it. Returns None if no server is listening on the socket.
+llvm::Optional<int> sendBuildRequest(llvm::StringRef socketPath, llvm::ArrayRef<const char*> args);
+
+} // namespace cx
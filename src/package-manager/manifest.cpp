@@ -1,5 +1,6 @@
 #include "manifest.h"
 #include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSwitch.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Path.h>
 #include <llvm/Support/Process.h>
@@ -35,8 +36,7 @@ PackageManifest::PackageManifest(std::string&& packageRoot) : packageRoot(std::m
 
     Module module(manifestFileName);
     CompileOptions options;
-    Parser parser(manifestPath, module, options);
-    parser.parse();
+    parseSourceFiles(manifestPath, module, options);
     // TODO: Type-check package manifest.
 
     auto& symbols = module.getSymbolTable();
@@ -44,6 +44,19 @@ PackageManifest::PackageManifest(std::string&& packageRoot) : packageRoot(std::m
     multitarget = getConfigValue<BoolLiteralExpr>(symbols.findOne("multitarget"), false);
     outputDirectory = getConfigValue<StringLiteralExpr>(symbols.findOne("outputDirectory"), "bin").str();
 
+    auto optimizationLevelName = getConfigValue<StringLiteralExpr>(symbols.findOne("optimizationLevel"), "0");
+    auto level = llvm::StringSwitch<llvm::Optional<OptimizationLevel>>(optimizationLevelName)
+                     .Case("0", OptimizationLevel::O0)
+                     .Case("1", OptimizationLevel::O1)
+                     .Case("2", OptimizationLevel::O2)
+                     .Case("3", OptimizationLevel::O3)
+                     .Case("s", OptimizationLevel::Os)
+                     .Default(llvm::None);
+    if (!level) {
+        ABORT("invalid optimizationLevel '" << optimizationLevelName << "' in " << manifestFileName << ", expected \"0\", \"1\", \"2\", \"3\", or \"s\"");
+    }
+    optimizationLevel = *level;
+
     if (auto* dependencies = symbols.findOne("dependencies")) {
         auto* array = llvm::cast<ArrayLiteralExpr>(llvm::cast<VarDecl>(dependencies)->getInitializer());
         for (auto& element : array->getElements()) {
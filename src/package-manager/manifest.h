@@ -6,6 +6,7 @@
 #include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/StringRef.h>
 #pragma warning(pop)
+#include "../driver/driver.h"
 
 namespace cx {
 
@@ -29,6 +30,7 @@ struct PackageManifest {
     std::vector<std::string> getTargetRootDirectories() const;
     bool isMultiTarget() const { return multitarget; }
     llvm::StringRef getOutputDirectory() const { return outputDirectory; }
+    OptimizationLevel getOptimizationLevel() const { return optimizationLevel; }
     static const char manifestFileName[];
 
 private:
@@ -37,6 +39,7 @@ private:
     std::vector<Dependency> declaredDependencies;
     bool multitarget = false;
     std::string outputDirectory;
+    OptimizationLevel optimizationLevel = OptimizationLevel::O0;
 };
 
 } // namespace cx
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CX_LEX_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define CX_LEX_AVX2 1
+#include <immintrin.h>
+#endif
+#pragma warning(push, 0)
+#include <llvm/Support/MathExtras.h>
+#pragma warning(pop)
+
+// Character scanning primitives used by the lexer to skip over runs of characters that don't need individual handling, such as
+// whitespace, comments, identifiers, and the contents of string literals. They compare 32 or 16 characters at a time using AVX2 or
+// SSE2 when the compiler targets them, and fall back to comparing one character at a time near the end of the buffer and on other
+// architectures. Only ASCII characters are ever matched as identifier characters, like std::isalnum does in the "C" locale.
+
+namespace cx {
+namespace scan {
+
+#if CX_LEX_SSE2
+struct Vector128 {
+    using Type = __m128i;
+    static constexpr int size = 16;
+    static Type load(const char* position) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(position)); }
+    static Type splat(char ch) { return _mm_set1_epi8(ch); }
+    static Type equal(Type a, char ch) { return _mm_cmpeq_epi8(a, splat(ch)); }
+    // Characters are compared as signed bytes, so non-ASCII characters are never in range.
+    static Type inRange(Type a, char low, char high) { return _mm_and_si128(_mm_cmpgt_epi8(a, splat(low - 1)), _mm_cmplt_epi8(a, splat(high + 1))); }
+    static Type bitOr(Type a, Type b) { return _mm_or_si128(a, b); }
+    static Type bitNot(Type a) { return _mm_xor_si128(a, _mm_set1_epi8(-1)); }
+    static uint32_t mask(Type a) { return uint32_t(_mm_movemask_epi8(a)); }
+};
+#endif
+
+#if CX_LEX_AVX2
+struct Vector256 {
+    using Type = __m256i;
+    static constexpr int size = 32;
+    static Type load(const char* position) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position)); }
+    static Type splat(char ch) { return _mm256_set1_epi8(ch); }
+    static Type equal(Type a, char ch) { return _mm256_cmpeq_epi8(a, splat(ch)); }
+    static Type inRange(Type a, char low, char high) {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(a, splat(low - 1)), _mm256_cmpgt_epi8(splat(high + 1), a));
+    }
+    static Type bitOr(Type a, Type b) { return _mm256_or_si256(a, b); }
+    static Type bitNot(Type a) { return _mm256_xor_si256(a, _mm256_set1_epi8(-1)); }
+    static uint32_t mask(Type a) { return uint32_t(_mm256_movemask_epi8(a)); }
+};
+#endif
+
+/// Matches any character other than a space, tab, or line terminator.
+struct NonWhitespace {
+    bool matches(char ch) const { return ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n'; }
+    template<typename V>
+    typename V::Type matches(typename V::Type chars) const {
+        auto whitespace = V::bitOr(V::bitOr(V::equal(chars, ' '), V::equal(chars, '\t')), V::bitOr(V::equal(chars, '\r'), V::equal(chars, '\n')));
+        return V::bitNot(whitespace);
+    }
+};
+
+/// Matches any character that can't appear in an identifier after its first character.
+struct NonIdentifierChar {
+    bool matches(char ch) const {
+        return !((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_');
+    }
+    template<typename V>
+    typename V::Type matches(typename V::Type chars) const {
+        auto letter = V::bitOr(V::inRange(chars, 'a', 'z'), V::inRange(chars, 'A', 'Z'));
+        auto identifierChar = V::bitOr(letter, V::bitOr(V::inRange(chars, '0', '9'), V::equal(chars, '_')));
+        return V::bitNot(identifierChar);
+    }
+};
+
+/// Matches the characters that end a line comment: a newline or the null terminator.
+struct LineCommentEnd {
+    bool matches(char ch) const { return ch == '\n' || ch == '\0'; }
+    template<typename V>
+    typename V::Type matches(typename V::Type chars) const {
+        return V::bitOr(V::equal(chars, '\n'), V::equal(chars, '\0'));
+    }
+};
+
+/// Matches the characters that can start or end a nested block comment, and the null terminator.
+struct BlockCommentDelimiter {
+    bool matches(char ch) const { return ch == '*' || ch == '/' || ch == '\0'; }
+    template<typename V>
+    typename V::Type matches(typename V::Type chars) const {
+        return V::bitOr(V::bitOr(V::equal(chars, '*'), V::equal(chars, '/')), V::equal(chars, '\0'));
+    }
+};
+
+/// Matches the characters that need special handling inside a string or character literal with the given delimiter.
+struct QuotedLiteralSpecialChar {
+    char delimiter;
+    bool matches(char ch) const { return ch == delimiter || ch == '\\' || ch == '\n' || ch == '\r' || ch == '\0'; }
+    template<typename V>
+    typename V::Type matches(typename V::Type chars) const {
+        auto lineTerminator = V::bitOr(V::equal(chars, '\n'), V::equal(chars, '\r'));
+        return V::bitOr(V::bitOr(V::equal(chars, delimiter), V::equal(chars, '\\')), V::bitOr(lineTerminator, V::equal(chars, '\0')));
+    }
+};
+
+/// Returns a pointer to the first character in [position, end) that the matcher matches, or end if there's none. Never reads
+/// outside of that range.
+template<typename Matcher>
+inline const char* findFirst(const char* position, const char* end, Matcher matcher) {
+#if CX_LEX_AVX2
+    for (; end - position >= Vector256::size; position += Vector256::size) {
+        if (auto mask = Vector256::mask(matcher.template matches<Vector256>(Vector256::load(position)))) {
+            return position + llvm::countTrailingZeros(mask);
+        }
+    }
+#endif
+#if CX_LEX_SSE2
+    for (; end - position >= Vector128::size; position += Vector128::size) {
+        if (auto mask = Vector128::mask(matcher.template matches<Vector128>(Vector128::load(position)))) {
+            return position + llvm::countTrailingZeros(mask);
+        }
+    }
+#endif
+    for (; position != end; ++position) {
+        if (matcher.matches(*position)) return position;
+    }
+    return end;
+}
+
+} // namespace scan
+} // namespace cx
@@ -1,52 +1,49 @@
 #include "lex.h"
+#include <algorithm>
 #include <cctype>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <vector>
 #pragma warning(push, 0)
-#include <llvm/ADT/StringMap.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/ErrorHandling.h>
-#include <llvm/Support/MemoryBuffer.h>
 #pragma warning(pop)
+#include "lex-scan.h"
 #include "parse.h"
 #include "../ast/token.h"
 #include "../support/utility.h"
 
 using namespace cx;
 
-std::vector<llvm::MemoryBuffer*> Lexer::fileBuffers;
-
-Lexer::Lexer(llvm::MemoryBuffer* input) : firstLocation(input->getBufferIdentifier().data(), 1, 0), lastLocation(input->getBufferIdentifier().data(), 1, 0) {
-    fileBuffers.push_back(input);
-    currentFilePosition = fileBuffers.back()->getBufferStart() - 1;
+Lexer::Lexer(FileID file, SourceLocation startLocation)
+: filePath(SourceManager::get().getFilePath(file)), fileContents(SourceManager::get().getContents(file).begin()),
+  fileEnd(SourceManager::get().getContents(file).end() + 1), currentFilePosition(fileContents - 1),
+  fileStartLocation(SourceManager::get().getStartLocation(file)) {
+    if (startLocation.isValid()) {
+        ASSERT(startLocation.getFileID() == file);
+        currentFilePosition += startLocation.getOffset() - fileStartLocation.getOffset();
+    }
 }
 
 const char* Lexer::getFilePath() const {
-    return fileBuffers.back()->getBufferIdentifier().data();
+    return filePath;
+}
+
+SourceLocation Lexer::getLocation(const char* position) const {
+    return fileStartLocation.getLocationWithOffset(int32_t(position - fileContents));
 }
 
 SourceLocation Lexer::getCurrentLocation() const {
-    return SourceLocation(getFilePath(), firstLocation.line, firstLocation.column);
+    return firstLocation;
 }
 
 char Lexer::readChar() {
-    char ch = *++currentFilePosition;
-    if (ch != '\n') {
-        lastLocation.column++;
-    } else {
-        lastLocation.line++;
-        lastLocation.column = 0;
-    }
-    return ch;
+    return *++currentFilePosition;
 }
 
-void Lexer::unreadChar(char ch) {
-    if (ch != '\n') {
-        lastLocation.column--;
-    } else {
-        lastLocation.line--;
-        // lastLocation.column can be left as is because the next readChar() call will reset it anyways.
-    }
+void Lexer::unreadChar(char) {
     currentFilePosition--;
 }
 
@@ -54,6 +51,7 @@ void Lexer::readBlockComment(SourceLocation startLocation) {
     int nestLevel = 1;
 
     while (true) {
+        currentFilePosition = scan::findFirst(currentFilePosition + 1, fileEnd, scan::BlockCommentDelimiter()) - 1;
         char ch = readChar();
 
         if (ch == '*') {
@@ -83,28 +81,24 @@ void Lexer::readBlockComment(SourceLocation startLocation) {
 
 Token Lexer::readQuotedLiteral(char delimiter, Token::Kind literalKind) {
     const char* begin = currentFilePosition;
-    const char* end = begin + 2;
-    bool escape = false;
 
     while (true) {
-        auto ch = readChar();
+        currentFilePosition = scan::findFirst(currentFilePosition + 1, fileEnd, scan::QuotedLiteralSpecialChar { delimiter });
+        char ch = *currentFilePosition;
 
-        if (escape) {
-            escape = false;
-        } else if (ch == delimiter) {
+        if (ch == delimiter) {
             break;
         } else if (ch == '\\') {
-            escape = true;
+            // Skip the escaped character, unless the backslash is the last character of the file.
+            if (currentFilePosition[1] != '\0') currentFilePosition++;
         } else if (ch == '\n' || ch == '\r') {
-            SourceLocation newlineLocation = firstLocation;
-            newlineLocation.column += end - begin - 1;
-            ERROR(newlineLocation, "newline inside " << toString(literalKind));
+            ERROR(getLocation(currentFilePosition), "newline inside " << toString(literalKind));
+        } else {
+            ERROR(firstLocation, "unterminated " << toString(literalKind));
         }
-
-        end++;
     }
 
-    return Token(literalKind, getCurrentLocation(), llvm::StringRef(begin, end - begin));
+    return Token(literalKind, getCurrentLocation(), llvm::StringRef(begin, currentFilePosition + 1 - begin));
 }
 
 Token Lexer::readNumber() {
@@ -123,7 +117,7 @@ Token Lexer::readNumber() {
                     end++;
                     continue;
                 }
-                if (std::isalnum(ch)) ERROR(lastLocation, "invalid digit '" << ch << "' in binary literal");
+                if (std::isalnum(ch)) ERROR(getLocation(currentFilePosition), "invalid digit '" << ch << "' in binary literal");
                 if (end == begin + 2) ERROR(firstLocation, "binary literal must have at least one digit after '0b'");
                 goto end;
             }
@@ -137,7 +131,7 @@ Token Lexer::readNumber() {
                     end++;
                     continue;
                 }
-                if (std::isalnum(ch)) ERROR(lastLocation, "invalid digit '" << ch << "' in octal literal");
+                if (std::isalnum(ch)) ERROR(getLocation(currentFilePosition), "invalid digit '" << ch << "' in octal literal");
                 if (end == begin + 2) ERROR(firstLocation, "octal literal must have at least one digit after '0o'");
                 goto end;
             }
@@ -168,15 +162,15 @@ Token Lexer::readNumber() {
                 if (std::isdigit(ch)) {
                     end++;
                 } else if (ch >= 'a' && ch <= 'f') {
-                    if (lettercase > 0) ERROR(lastLocation, "mixed letter case in hex literal");
+                    if (lettercase > 0) ERROR(getLocation(currentFilePosition), "mixed letter case in hex literal");
                     end++;
                     lettercase = -1;
                 } else if (ch >= 'A' && ch <= 'F') {
-                    if (lettercase < 0) ERROR(lastLocation, "mixed letter case in hex literal");
+                    if (lettercase < 0) ERROR(getLocation(currentFilePosition), "mixed letter case in hex literal");
                     end++;
                     lettercase = 1;
                 } else {
-                    if (std::isalnum(ch)) ERROR(lastLocation, "invalid digit '" << ch << "' in hex literal");
+                    if (std::isalnum(ch)) ERROR(getLocation(currentFilePosition), "invalid digit '" << ch << "' in hex literal");
                     if (end == begin + 2) ERROR(firstLocation, "hex literal must have at least one digit after '0x'");
                     goto end;
                 }
@@ -197,7 +191,24 @@ end:
     return Token(isFloat ? Token::FloatLiteral : Token::IntegerLiteral, getCurrentLocation(), llvm::StringRef(begin, end - begin));
 }
 
-static const llvm::StringMap<Token::Kind> keywords = {
+namespace {
+
+struct Keyword {
+    std::string_view spelling;
+    Token::Kind kind;
+};
+
+/// A hash table mapping each keyword to its token kind, without collisions, so that looking up an identifier needs at most one string
+/// comparison. It's built at compile time, which checks that the hash function is still perfect whenever keywords are added.
+struct KeywordTable {
+    static constexpr size_t size = 64;
+    Keyword entries[size];
+    bool hasCollisions;
+};
+
+} // namespace
+
+static constexpr Keyword keywords[] = {
     { "addressof", Token::Addressof },
     { "as", Token::As },
     { "break", Token::Break },
@@ -232,27 +243,64 @@ static const llvm::StringMap<Token::Kind> keywords = {
     { "#endif", Token::HashEndif },
 };
 
+static constexpr size_t minKeywordLength = 2;
+static constexpr size_t maxKeywordLength = 9;
+
+static constexpr size_t hashKeyword(std::string_view string) {
+    return (uint8_t(string.front()) * 2 + uint8_t(string.back()) * 15 + string.size() * 6) % KeywordTable::size;
+}
+
+static constexpr KeywordTable createKeywordTable() {
+    KeywordTable table = {};
+    for (auto& keyword : keywords) {
+        auto& entry = table.entries[hashKeyword(keyword.spelling)];
+        if (!entry.spelling.empty() || keyword.spelling.size() < minKeywordLength || keyword.spelling.size() > maxKeywordLength) {
+            table.hasCollisions = true;
+        }
+        entry = keyword;
+    }
+    return table;
+}
+
+static constexpr KeywordTable keywordTable = createKeywordTable();
+static_assert(!keywordTable.hasCollisions, "keyword hash function isn't perfect anymore, adjust its multipliers or the table size");
+
+Token::Kind cx::getKeywordKind(llvm::StringRef string) {
+    if (string.size() < minKeywordLength || string.size() > maxKeywordLength) return Token::Identifier;
+    auto& entry = keywordTable.entries[hashKeyword(std::string_view(string.data(), string.size()))];
+    if (entry.spelling.size() != string.size() || std::memcmp(entry.spelling.data(), string.data(), string.size()) != 0) return Token::Identifier;
+    return entry.kind;
+}
+
 Token Lexer::nextToken() {
+    const char* previousTokenEnd = currentFilePosition + 1;
+    Token token = readToken();
+
+    // Tokens never span multiple lines, so a token starts a line exactly when there's a newline between it and the previous token.
+    const char* tokenBegin = fileContents + (token.getLocation().getOffset() - fileStartLocation.getOffset());
+    token.setAtStartOfLine(std::find(previousTokenEnd, tokenBegin, '\n') != tokenBegin);
+    return token;
+}
+
+Token Lexer::readToken() {
     while (true) {
         char ch = readChar();
-        firstLocation.line = lastLocation.line;
-        firstLocation.column = lastLocation.column;
+        firstLocation = getLocation(currentFilePosition);
 
         switch (ch) {
             case ' ':
             case '\t':
             case '\r':
             case '\n':
-                break; // skip whitespace
+                // skip whitespace
+                currentFilePosition = scan::findFirst(currentFilePosition + 1, fileEnd, scan::NonWhitespace()) - 1;
+                break;
             case '/':
                 ch = readChar();
                 if (ch == '/') {
                     // comment until end of line
-                    while (true) {
-                        char ch = readChar();
-                        if (ch == '\n') break;
-                        if (ch == '\0') goto end;
-                    }
+                    currentFilePosition = scan::findFirst(currentFilePosition + 1, fileEnd, scan::LineCommentEnd());
+                    if (*currentFilePosition == '\0') goto end;
                 } else if (ch == '*') {
                     readBlockComment(firstLocation);
                 } else if (ch == '=') {
@@ -400,20 +448,14 @@ Token Lexer::nextToken() {
                 }
 
                 const char* begin = currentFilePosition;
-                const char* end = begin;
-                do {
-                    end++;
-                } while (std::isalnum(ch = readChar()) || ch == '_');
-                unreadChar(ch);
+                const char* end = scan::findFirst(begin + 1, fileEnd, scan::NonIdentifierChar());
+                currentFilePosition = end - 1;
 
                 llvm::StringRef string(begin, end - begin);
+                auto kind = getKeywordKind(string);
+                if (kind == Token::Identifier) string = Identifier(string).getString();
 
-                auto it = keywords.find(string);
-                if (it != keywords.end()) {
-                    return Token(it->second, getCurrentLocation(), string);
-                }
-
-                return Token(Token::Identifier, getCurrentLocation(), string);
+                return Token(kind, getCurrentLocation(), string);
         }
     }
 
@@ -1,24 +1,20 @@
 #pragma once
 
 #include <vector>
+#include "../ast/source-manager.h"
 #include "../ast/token.h"
 
-namespace llvm {
-class MemoryBuffer;
-}
-
 namespace cx {
 
-struct SourceLocation;
-
 struct Lexer {
-    Lexer(llvm::MemoryBuffer* input);
+    /// Lexes the given file from its start, or from the given location in it if the location is valid.
+    Lexer(FileID file, SourceLocation startLocation = SourceLocation());
     Token nextToken();
     const char* getFilePath() const;
 
-    static std::vector<llvm::MemoryBuffer*> fileBuffers; // TODO: Make this non-static.
-
 private:
+    Token readToken();
+    SourceLocation getLocation(const char* position) const;
     SourceLocation getCurrentLocation() const;
     char readChar();
     void unreadChar(char ch);
@@ -26,9 +22,17 @@ private:
     Token readQuotedLiteral(char delimiter, Token::Kind literalKind);
     Token readNumber();
 
+    const char* filePath;
+    const char* fileContents;
+    /// One past the null terminator of the file contents.
+    const char* fileEnd;
     const char* currentFilePosition;
+    SourceLocation fileStartLocation;
+    /// The location of the first character of the token being lexed.
     SourceLocation firstLocation;
-    SourceLocation lastLocation;
 };
 
+/// Returns the token kind of the keyword with the given spelling, or Token::Identifier if the string isn't a keyword.
+Token::Kind getKeywordKind(llvm::StringRef string);
+
 } // namespace cx
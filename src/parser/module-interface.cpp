@@ -0,0 +1,615 @@
+#include "module-interface.h"
+#pragma warning(push, 0)
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/LEB128.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#pragma warning(pop)
+#include "../ast/module.h"
+#include "../ast/source-manager.h"
+#include "../driver/driver.h"
+#include "../support/utility.h"
+
+using namespace cx;
+
+static const char moduleInterfaceMagic[] = { 'C', 'X', 'M', 'I' };
+// Increment this whenever the format changes or the C header importer starts producing different declarations.
+static const uint64_t moduleInterfaceVersion = 5;
+
+static void hashStrings(llvm::MD5& hash, llvm::ArrayRef<std::string> strings) {
+    for (auto& string : strings) {
+        hash.update(string);
+        hash.update(llvm::StringRef("\0", 1));
+    }
+    hash.update("\n");
+}
+
+static void hashCompilerAndOptions(llvm::MD5& hash, const CompileOptions& options) {
+    hash.update(std::to_string(moduleInterfaceVersion));
+
+    // Invalidate the interface whenever the compiler itself changes.
+    auto compilerPath = llvm::sys::fs::getMainExecutable(nullptr, (void*) (intptr_t) &hashCompilerAndOptions);
+    llvm::sys::fs::file_status compilerStatus;
+    if (!llvm::sys::fs::status(compilerPath, compilerStatus)) {
+        hash.update(compilerPath);
+        hash.update(std::to_string(compilerStatus.getLastModificationTime().time_since_epoch().count()));
+    }
+
+    hashStrings(hash, options.defines);
+    hashStrings(hash, options.importSearchPaths);
+    hashStrings(hash, options.frameworkSearchPaths);
+}
+
+namespace {
+
+struct ModuleInterfaceWriter {
+    explicit ModuleInterfaceWriter(std::string& buffer) : stream(buffer) {}
+
+    void writeInt(uint64_t value) { llvm::encodeULEB128(value, stream); }
+    void writeSignedInt(int64_t value) { llvm::encodeSLEB128(value, stream); }
+    void writeBool(bool value) { writeInt(value); }
+
+    void writeString(llvm::StringRef string) {
+        writeInt(string.size());
+        stream << string;
+    }
+
+    /// Writes the location as an index into the file path table and an offset within that file, because the encoded location
+    /// depends on the order in which files were loaded by the current process.
+    void writeLocation(SourceLocation location) {
+        auto file = location.getFileID();
+        if (file == 0) {
+            writeInt(0);
+            return;
+        }
+
+        auto it = fileIndices.try_emplace(file, unsigned(fileIndices.size()));
+        if (it.second) filePaths.push_back(SourceManager::get().getFilePath(file));
+        writeInt(it.first->second + 1);
+        writeInt(location.getOffset() - SourceManager::get().getStartLocation(file).getOffset());
+    }
+
+    void writeAPInt(const llvm::APInt& value) {
+        writeInt(value.getBitWidth());
+        for (unsigned i = 0; i < value.getNumWords(); ++i) {
+            writeInt(value.getRawData()[i]);
+        }
+    }
+
+    void writeType(Type type) {
+        writeInt(type ? unsigned(type.getKind()) + 1 : 0);
+        writeInt(unsigned(type.getMutability()));
+        writeLocation(type.getLocation());
+        if (!type) return;
+
+        switch (type.getKind()) {
+            case TypeKind::BasicType:
+                writeString(type.getName());
+                writeTypes(type.getGenericArgs());
+                break;
+            case TypeKind::ArrayType:
+                writeType(type.getElementType());
+                writeSignedInt(type.getArraySize());
+                break;
+            case TypeKind::FunctionType:
+                writeType(type.getReturnType());
+                writeTypes(type.getParamTypes());
+                break;
+            case TypeKind::PointerType:
+                writeType(type.getPointee());
+                break;
+            case TypeKind::TupleType:
+            case TypeKind::UnresolvedType:
+                llvm_unreachable("not produced by the C header importer");
+        }
+    }
+
+    void writeTypes(llvm::ArrayRef<Type> types) {
+        writeInt(types.size());
+        for (auto type : types) {
+            writeType(type);
+        }
+    }
+
+    void writeExpr(const Expr* expr) {
+        writeInt(expr ? unsigned(expr->getKind()) + 1 : 0);
+        if (!expr) return;
+        writeLocation(expr->getLocation());
+
+        switch (expr->getKind()) {
+            case ExprKind::IntLiteralExpr: {
+                auto& value = llvm::cast<IntLiteralExpr>(expr)->getValue();
+                writeBool(value.isUnsigned());
+                writeAPInt(value);
+                break;
+            }
+            case ExprKind::FloatLiteralExpr: {
+                auto& value = llvm::cast<FloatLiteralExpr>(expr)->getValue();
+                writeInt(llvm::APFloat::SemanticsToEnum(value.getSemantics()));
+                writeAPInt(value.bitcastToAPInt());
+                break;
+            }
+            default:
+                llvm_unreachable("not produced by the C header importer");
+        }
+    }
+
+    void writeVarDecl(const VarDecl& decl) {
+        writeType(decl.getType());
+        writeString(decl.getName());
+        writeExpr(decl.getInitializer());
+        writeInt(unsigned(decl.getAccessLevel()));
+        writeLocation(decl.getLocation());
+    }
+
+    void writeFunctionDecl(const FunctionDecl& decl) {
+        ASSERT(!decl.hasBody());
+        writeInt(unsigned(decl.getAccessLevel()));
+        writeLocation(decl.getLocation());
+        writeString(decl.getName());
+        writeType(decl.getReturnType());
+        writeBool(decl.isVariadic());
+        writeBool(decl.isExtern());
+        writeString(decl.getProto().asmLabel);
+        writeInt(decl.getParams().size());
+        for (auto& param : decl.getParams()) {
+            writeType(param.getType());
+            writeString(param.getName());
+            writeBool(param.isPublic);
+            writeLocation(param.getLocation());
+        }
+    }
+
+    void writeTypeDecl(const TypeDecl& decl) {
+        ASSERT(decl.getMethods().empty() && decl.getInterfaces().empty());
+        writeInt(unsigned(decl.getTag()));
+        writeString(decl.getName());
+        writeInt(unsigned(decl.getAccessLevel()));
+        writeLocation(decl.getLocation());
+        writeBool(decl.packed);
+
+        writeInt(decl.getFields().size());
+        for (auto& field : decl.getFields()) {
+            writeType(field.getType());
+            writeString(field.getName());
+            writeInt(unsigned(field.getAccessLevel()));
+            writeLocation(field.getLocation());
+        }
+    }
+
+    void writeEnumDecl(const EnumDecl& decl) {
+        writeString(decl.getName());
+        writeInt(unsigned(decl.getAccessLevel()));
+        writeLocation(decl.getLocation());
+        writeInt(decl.getCases().size());
+        for (auto& enumCase : decl.getCases()) {
+            ASSERT(!enumCase.getAssociatedType());
+            writeString(enumCase.getName());
+            writeExpr(enumCase.getValue());
+            writeInt(unsigned(enumCase.getAccessLevel()));
+            writeLocation(enumCase.getLocation());
+        }
+    }
+
+    void writeDecl(const Decl& decl) {
+        writeInt(unsigned(decl.getKind()));
+
+        switch (decl.getKind()) {
+            case DeclKind::FunctionDecl:
+                writeFunctionDecl(llvm::cast<FunctionDecl>(decl));
+                break;
+            case DeclKind::TypeDecl:
+                writeTypeDecl(llvm::cast<TypeDecl>(decl));
+                break;
+            case DeclKind::EnumDecl:
+                writeEnumDecl(llvm::cast<EnumDecl>(decl));
+                break;
+            case DeclKind::VarDecl:
+                writeVarDecl(llvm::cast<VarDecl>(decl));
+                break;
+            default:
+                llvm_unreachable("not produced by the C header importer");
+        }
+    }
+
+    llvm::raw_string_ostream stream;
+    llvm::DenseMap<FileID, unsigned> fileIndices;
+    std::vector<const char*> filePaths;
+};
+
+/// Thrown by ModuleInterfaceReader when the module interface file is truncated or otherwise malformed.
+struct InvalidModuleInterface {};
+
+struct ModuleInterfaceReader {
+    /// Creates a reader for a file opened with openModuleInterfaceFile, positioned after the header.
+    ModuleInterfaceReader(llvm::StringRef buffer, Module& module) : current(buffer.begin()), end(buffer.end()), module(module) {
+        current += sizeof(moduleInterfaceMagic);
+        readInt(); // version
+    }
+
+    uint64_t readInt() {
+        unsigned size;
+        const char* error = nullptr;
+        auto value = llvm::decodeULEB128(reinterpret_cast<const uint8_t*>(current), &size, reinterpret_cast<const uint8_t*>(end), &error);
+        if (error) throw InvalidModuleInterface();
+        current += size;
+        return value;
+    }
+
+    int64_t readSignedInt() {
+        unsigned size;
+        const char* error = nullptr;
+        auto value = llvm::decodeSLEB128(reinterpret_cast<const uint8_t*>(current), &size, reinterpret_cast<const uint8_t*>(end), &error);
+        if (error) throw InvalidModuleInterface();
+        current += size;
+        return value;
+    }
+
+    bool readBool() { return readInt() != 0; }
+
+    template<typename EnumType>
+    EnumType readEnum(EnumType last) {
+        auto value = readInt();
+        if (value > uint64_t(last)) throw InvalidModuleInterface();
+        return EnumType(value);
+    }
+
+    /// Reads a collection size, checking that the collection could fit in the remaining bytes.
+    size_t readSize() {
+        auto size = readInt();
+        if (size > uint64_t(end - current)) throw InvalidModuleInterface();
+        return size_t(size);
+    }
+
+    std::string readString() {
+        auto size = readSize();
+        std::string string(current, size);
+        current += size;
+        return string;
+    }
+
+    Identifier readIdentifier() { return Identifier(readString()); }
+
+    void readFilePaths() {
+        for (size_t i = 0, size = readSize(); i < size; ++i) {
+            auto file = SourceManager::get().reserveFile(readString());
+            fileStartLocations.push_back(file ? SourceManager::get().getStartLocation(*file) : SourceLocation());
+        }
+    }
+
+    SourceLocation readLocation() {
+        auto fileIndex = readInt();
+        if (fileIndex > fileStartLocations.size()) throw InvalidModuleInterface();
+        if (fileIndex == 0) return SourceLocation();
+        auto offset = readInt();
+        auto fileStartLocation = fileStartLocations[fileIndex - 1];
+        if (!fileStartLocation.isValid()) return SourceLocation();
+        return fileStartLocation.getLocationWithOffset(int32_t(offset));
+    }
+
+    llvm::APInt readAPInt() {
+        auto bitWidth = readInt();
+        if (bitWidth == 0 || bitWidth > UINT16_MAX) throw InvalidModuleInterface();
+        llvm::SmallVector<uint64_t, 1> words;
+        for (unsigned i = 0, e = llvm::APInt::getNumWords(unsigned(bitWidth)); i < e; ++i) {
+            words.push_back(readInt());
+        }
+        return llvm::APInt(unsigned(bitWidth), words);
+    }
+
+    Type readType() {
+        auto kind = readInt();
+        if (kind > unsigned(TypeKind::UnresolvedType) + 1) throw InvalidModuleInterface();
+        auto mutability = readEnum(Mutability::Const);
+        auto location = readLocation();
+        if (kind == 0) return Type(nullptr, mutability, location);
+
+        switch (TypeKind(kind - 1)) {
+            case TypeKind::BasicType: {
+                auto name = readIdentifier();
+                auto genericArgs = readTypes();
+                return BasicType::get(name, genericArgs, mutability, location);
+            }
+            case TypeKind::ArrayType: {
+                auto elementType = readType();
+                auto size = readSignedInt();
+                return ArrayType::get(elementType, size, location).withMutability(mutability);
+            }
+            case TypeKind::FunctionType: {
+                auto returnType = readType();
+                return FunctionType::get(returnType, readTypes(), mutability, location);
+            }
+            case TypeKind::PointerType:
+                return PointerType::get(readType(), mutability, location);
+            case TypeKind::TupleType:
+            case TypeKind::UnresolvedType:
+                throw InvalidModuleInterface();
+        }
+        llvm_unreachable("all cases handled");
+    }
+
+    std::vector<Type> readTypes() {
+        std::vector<Type> types(readSize());
+        for (auto& type : types) {
+            type = readType();
+        }
+        return types;
+    }
+
+    Expr* readExpr() {
+        auto kind = readInt();
+        if (kind == 0) return nullptr;
+        auto location = readLocation();
+
+        switch (ExprKind(kind - 1)) {
+            case ExprKind::IntLiteralExpr: {
+                bool isUnsigned = readBool();
+                return new IntLiteralExpr(llvm::APSInt(readAPInt(), isUnsigned), location);
+            }
+            case ExprKind::FloatLiteralExpr: {
+                auto& semantics = llvm::APFloat::EnumToSemantics(readEnum(llvm::APFloat::S_PPCDoubleDouble));
+                auto bits = readAPInt();
+                if (bits.getBitWidth() != llvm::APFloat::semanticsSizeInBits(semantics)) throw InvalidModuleInterface();
+                return new FloatLiteralExpr(llvm::APFloat(semantics, bits), location);
+            }
+            default:
+                throw InvalidModuleInterface();
+        }
+    }
+
+    VarDecl* readVarDecl() {
+        auto type = readType();
+        auto name = readIdentifier();
+        auto* initializer = readExpr();
+        auto accessLevel = readEnum(AccessLevel::Default);
+        return new VarDecl(type, name, initializer, nullptr, accessLevel, module, readLocation());
+    }
+
+    FunctionDecl* readFunctionDecl() {
+        auto accessLevel = readEnum(AccessLevel::Default);
+        auto location = readLocation();
+        auto name = readIdentifier();
+        auto returnType = readType();
+        bool isVariadic = readBool();
+        bool isExtern = readBool();
+        auto asmLabel = readString();
+        std::vector<ParamDecl> params;
+        for (size_t i = 0, size = readSize(); i < size; ++i) {
+            auto type = readType();
+            auto paramName = readIdentifier();
+            bool isPublic = readBool();
+            params.push_back(ParamDecl(type, paramName, isPublic, readLocation()));
+        }
+
+        FunctionProto proto(name, std::move(params), returnType, isVariadic, isExtern);
+        proto.asmLabel = std::move(asmLabel);
+        return new FunctionDecl(std::move(proto), std::vector<Type>(), accessLevel, module, location);
+    }
+
+    TypeDecl* readTypeDecl() {
+        auto tag = readEnum(TypeTag::Enum);
+        auto name = readIdentifier();
+        auto accessLevel = readEnum(AccessLevel::Default);
+        auto location = readLocation();
+        auto typeDecl = new TypeDecl(tag, name, std::vector<Type>(), std::vector<Type>(), accessLevel, module, nullptr, location);
+        typeDecl->packed = readBool();
+
+        for (size_t i = 0, size = readSize(); i < size; ++i) {
+            auto type = readType();
+            auto fieldName = readIdentifier();
+            auto fieldAccessLevel = readEnum(AccessLevel::Default);
+            typeDecl->addField(FieldDecl(type, fieldName, nullptr, *typeDecl, fieldAccessLevel, readLocation()));
+        }
+
+        return typeDecl;
+    }
+
+    EnumDecl* readEnumDecl() {
+        auto name = readIdentifier();
+        auto accessLevel = readEnum(AccessLevel::Default);
+        auto location = readLocation();
+        std::vector<EnumCase> cases;
+        for (size_t i = 0, size = readSize(); i < size; ++i) {
+            auto caseName = readIdentifier();
+            auto* value = readExpr();
+            if (!value) throw InvalidModuleInterface();
+            auto caseAccessLevel = readEnum(AccessLevel::Default);
+            cases.push_back(EnumCase(caseName, value, Type(), caseAccessLevel, readLocation()));
+        }
+        return new EnumDecl(name, std::move(cases), accessLevel, module, nullptr, location);
+    }
+
+    Decl* readDecl() {
+        switch (readEnum(DeclKind::ImportDecl)) {
+            case DeclKind::FunctionDecl:
+                return readFunctionDecl();
+            case DeclKind::TypeDecl:
+                return readTypeDecl();
+            case DeclKind::EnumDecl:
+                return readEnumDecl();
+            case DeclKind::VarDecl:
+                return readVarDecl();
+            default:
+                throw InvalidModuleInterface();
+        }
+    }
+
+    const char* current;
+    const char* end;
+    Module& module;
+    /// The locations of the beginnings of the files in the file path table, or invalid locations for files that can't be read.
+    std::vector<SourceLocation> fileStartLocations;
+};
+
+} // namespace
+
+/// Writes a module interface file consisting of the header, the given preamble used for validating the file, the table of file paths
+/// referenced by source locations, and the given body.
+static void writeModuleInterfaceFile(llvm::StringRef path, ModuleInterfaceWriter& preambleWriter, ModuleInterfaceWriter& bodyWriter) {
+    preambleWriter.stream.flush();
+    bodyWriter.stream.flush();
+
+    std::string buffer(moduleInterfaceMagic, sizeof(moduleInterfaceMagic));
+    ModuleInterfaceWriter writer(buffer);
+    writer.writeInt(moduleInterfaceVersion);
+    writer.stream << preambleWriter.stream.str();
+
+    // The file path table is only complete after the body has been written, so the body is written into a separate buffer first.
+    writer.writeInt(bodyWriter.filePaths.size());
+    for (auto* filePath : bodyWriter.filePaths) {
+        writer.writeString(filePath);
+    }
+
+    writer.stream << bodyWriter.stream.str();
+    writer.stream.flush();
+
+    if (auto error = llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path))) {
+        ABORT("couldn't create module cache directory '" << llvm::sys::path::parent_path(path) << "': " << error.message());
+    }
+
+    // Write to a unique file first and then rename it, so that concurrent builds never see a partially written module interface.
+    llvm::SmallString<128> temporaryPath;
+    llvm::sys::fs::createUniquePath(path + "-%%%%%%%%", temporaryPath, false);
+    std::error_code error;
+    llvm::raw_fd_ostream file(temporaryPath, error);
+    if (error) ABORT("couldn't open '" << temporaryPath << "': " << error.message());
+    file << buffer;
+    file.close();
+
+    if (auto error = llvm::sys::fs::rename(temporaryPath, path)) {
+        ABORT("couldn't rename '" << temporaryPath << "' to '" << path << "': " << error.message());
+    }
+}
+
+/// Memory-maps the given module interface file and checks its header. Returns null if the file doesn't exist or has the wrong format.
+static std::unique_ptr<llvm::MemoryBuffer> openModuleInterfaceFile(llvm::StringRef path) {
+    auto file = llvm::MemoryBuffer::getFile(path, -1, false);
+    if (!file) return nullptr;
+
+    llvm::StringRef buffer = (*file)->getBuffer();
+    if (!buffer.consume_front(llvm::StringRef(moduleInterfaceMagic, sizeof(moduleInterfaceMagic)))) return nullptr;
+
+    unsigned size;
+    const char* error = nullptr;
+    auto version = llvm::decodeULEB128(buffer.bytes_begin(), &size, buffer.bytes_end(), &error);
+    if (error || version != moduleInterfaceVersion) return nullptr;
+
+    return std::move(*file);
+}
+
+std::string cx::getCHeaderInterfacePath(llvm::StringRef cacheDirectory, llvm::StringRef headerName, llvm::StringRef importerDirectory,
+                                        const CompileOptions& options) {
+    llvm::MD5 hash;
+    hashCompilerAndOptions(hash, options);
+    hash.update(headerName);
+    hash.update(llvm::StringRef("\0", 1));
+    hash.update(importerDirectory);
+    hash.update(llvm::StringRef("\0", 1));
+    hashStrings(hash, options.cflags);
+    hashStrings(hash, { options.targetTriple, options.targetCPU, options.targetFeatures });
+
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+    llvm::SmallString<128> path(cacheDirectory);
+    llvm::sys::path::append(path, llvm::sys::path::filename(headerName) + "-" + result.digest() + ".cxi");
+    return path.str().str();
+}
+
+void cx::writeCHeaderInterface(const Module& module, const CHeaderDecls& cHeaderDecls, llvm::StringRef path) {
+    std::string preamble;
+    ModuleInterfaceWriter preambleWriter(preamble);
+    preambleWriter.writeInt(module.getCHeaderFilePaths().size());
+    for (auto& headerFilePath : module.getCHeaderFilePaths()) {
+        llvm::sys::fs::file_status status;
+        if (llvm::sys::fs::status(headerFilePath, status)) return;
+        preambleWriter.writeString(headerFilePath);
+        preambleWriter.writeSignedInt(status.getLastModificationTime().time_since_epoch().count());
+        preambleWriter.writeInt(status.getSize());
+    }
+
+    std::string body;
+    ModuleInterfaceWriter bodyWriter(body);
+    bodyWriter.writeInt(cHeaderDecls.decls.size());
+    for (auto* decl : cHeaderDecls.decls) {
+        bodyWriter.writeDecl(*decl);
+    }
+    bodyWriter.writeInt(cHeaderDecls.identifierReplacements.size());
+    for (auto& replacement : cHeaderDecls.identifierReplacements) {
+        bodyWriter.writeString(replacement.first);
+        bodyWriter.writeString(replacement.second);
+    }
+    bodyWriter.writeInt(cHeaderDecls.typedefs.size());
+    for (auto& typedefNames : cHeaderDecls.typedefs) {
+        bodyWriter.writeString(typedefNames.first);
+        bodyWriter.writeString(typedefNames.second);
+    }
+
+    writeModuleInterfaceFile(path, preambleWriter, bodyWriter);
+}
+
+bool cx::readCHeaderInterface(Module& module, llvm::StringRef path) {
+    auto file = openModuleInterfaceFile(path);
+    if (!file) return false;
+
+    ModuleInterfaceReader reader(file->getBuffer(), module);
+    std::vector<std::string> headerFilePaths;
+    CHeaderDecls cHeaderDecls;
+
+    try {
+        // Check that none of the headers included by the imported header have been modified since the file was written.
+        for (size_t i = 0, size = reader.readSize(); i < size; ++i) {
+            headerFilePaths.push_back(reader.readString());
+            auto modificationTime = reader.readSignedInt();
+            auto fileSize = reader.readInt();
+            llvm::sys::fs::file_status status;
+            if (llvm::sys::fs::status(headerFilePaths.back(), status)) return false;
+            if (status.getLastModificationTime().time_since_epoch().count() != modificationTime || status.getSize() != fileSize) return false;
+        }
+
+        reader.readFilePaths();
+
+        cHeaderDecls.decls.resize(reader.readSize());
+        for (auto& decl : cHeaderDecls.decls) {
+            decl = reader.readDecl();
+        }
+        for (size_t i = 0, size = reader.readSize(); i < size; ++i) {
+            auto source = reader.readString();
+            cHeaderDecls.identifierReplacements.emplace_back(std::move(source), reader.readString());
+            if (cHeaderDecls.identifierReplacements.back().second.empty()) throw InvalidModuleInterface();
+        }
+        for (size_t i = 0, size = reader.readSize(); i < size; ++i) {
+            auto typedefName = reader.readString();
+            cHeaderDecls.typedefs.emplace_back(std::move(typedefName), reader.readString());
+        }
+
+        if (reader.current != reader.end) return false;
+    } catch (const InvalidModuleInterface&) {
+        return false;
+    }
+
+    for (auto* decl : cHeaderDecls.decls) {
+        // The C header importer sets the types of the initializers of the constants it creates from enumerators and macros.
+        if (auto* varDecl = llvm::dyn_cast<VarDecl>(decl)) {
+            if (auto* initializer = varDecl->getInitializer()) {
+                initializer->setType(varDecl->getType());
+            }
+        }
+        module.addToSymbolTable(decl);
+    }
+    for (auto& replacement : cHeaderDecls.identifierReplacements) {
+        module.addIdentifierReplacement(Identifier(replacement.first), Identifier(replacement.second));
+    }
+    for (auto& typedefNames : cHeaderDecls.typedefs) {
+        llvm::cast<BasicType>(BasicType::get(Identifier(typedefNames.first), {}).getBase())->setName(std::string(typedefNames.second));
+    }
+    for (auto& headerFilePath : headerFilePaths) {
+        module.addCHeaderFilePath(headerFilePath);
+    }
+
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#pragma warning(push, 0)
+#include <llvm/ADT/StringRef.h>
+#pragma warning(pop)
+
+namespace cx {
+
+struct CompileOptions;
+struct Decl;
+struct Module;
+
+/// Module interface files store the declarations imported from a C header in a compact binary format, so that later imports of
+/// the header can be deserialized from a single memory-mapped file instead of running Clang on it.
+
+/// The effects of importing a C header on the module created for it, in the order in which the C header importer performed them.
+struct CHeaderDecls {
+    /// Declarations added to the symbol table with Module::addToSymbolTable(Decl*).
+    std::vector<Decl*> decls;
+    /// Identifier replacements created from macros, as pairs of macro names and replacements.
+    std::vector<std::pair<std::string, std::string>> identifierReplacements;
+    /// Typedefs that rename a BasicType, as pairs of typedef names and underlying type names.
+    std::vector<std::pair<std::string, std::string>> typedefs;
+};
+
+/// Returns the path of the module interface file for the given C header in the given cache directory. The file name is a hash
+/// of the header name, the compiler executable, and all options that affect how the header is found and parsed.
+std::string getCHeaderInterfacePath(llvm::StringRef cacheDirectory, llvm::StringRef headerName, llvm::StringRef importerDirectory,
+                                    const CompileOptions& options);
+
+/// Writes the declarations imported from a C header into a module interface file, along with the modification times of all
+/// header files that were parsed, which are read from Module::getCHeaderFilePaths().
+void writeCHeaderInterface(const Module& module, const CHeaderDecls& cHeaderDecls, llvm::StringRef path);
+
+/// Replays the effects of a C header import stored in the given module interface file on the module. Returns false, leaving the
+/// module unchanged, if the file doesn't exist, is malformed, or any of the parsed header files has been modified since.
+bool readCHeaderInterface(Module& module, llvm::StringRef path);
+
+} // namespace cx
@@ -1,39 +1,115 @@
 #include "parse.h"
+#include <algorithm>
 #include <forward_list>
 #include <sstream>
 #include <vector>
 #pragma warning(push, 0)
 #include <llvm/ADT/APSInt.h>
 #include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/Optional.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/ErrorHandling.h>
 #include <llvm/Support/FileSystem.h>
-#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/SaveAndRestore.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
 #pragma warning(pop)
 #include "lex.h"
 #include "../ast/decl.h"
 #include "../ast/module.h"
 #include "../ast/token.h"
 #include "../driver/driver.h"
+#include "../support/time-report.h"
 #include "../support/utility.h"
 
 using namespace cx;
 
-static llvm::MemoryBuffer* getFileMemoryBuffer(llvm::StringRef filePath) {
-    auto buffer = llvm::MemoryBuffer::getFile(filePath);
-    if (!buffer) ABORT("couldn't open file '" << filePath << "'");
-    return buffer->release();
+/// The initial capacity of the token buffer, which is enough for the lookahead of nearly all statements.
+static const size_t initialTokenBufferCapacity = 64;
+
+static FileID loadSourceFile(llvm::StringRef filePath) {
+    auto file = SourceManager::get().loadFile(filePath);
+    if (!file) ABORT("couldn't open file '" << filePath << "'");
+    return *file;
+}
+
+Parser::Parser(llvm::StringRef filePath, Module& module, const CompileOptions& options, bool skipFunctionBodies)
+: lexer(loadSourceFile(filePath)), currentModule(&module), tokenBuffer(initialTokenBufferCapacity), firstBufferedTokenIndex(0),
+  endBufferedTokenIndex(0), currentTokenIndex(0), options(options), skipFunctionBodies(skipFunctionBodies), hasLexerError(false),
+  hasSyntaxErrors(false) {
+    lexTokensUntil(0);
+}
+
+Parser::Parser(SourceLocation startLocation, Module& module, const CompileOptions& options)
+: lexer(startLocation.getFileID(), startLocation), currentModule(&module), tokenBuffer(initialTokenBufferCapacity), firstBufferedTokenIndex(0),
+  endBufferedTokenIndex(0), currentTokenIndex(0), options(options), skipFunctionBodies(false), hasLexerError(false),
+  hasSyntaxErrors(false) {
+    lexTokensUntil(0);
+}
+
+Parser::Checkpoint::Checkpoint(Parser& parser) : parser(parser), tokenIndex(parser.currentTokenIndex) {
+    parser.checkpoints.push_back(tokenIndex);
 }
 
-Parser::Parser(llvm::StringRef filePath, Module& module, const CompileOptions& options)
-: lexer(getFileMemoryBuffer(filePath)), currentModule(&module), currentTokenIndex(0), options(options) {
-    tokenBuffer.emplace_back(lexer.nextToken());
+Parser::Checkpoint::~Checkpoint() {
+    ASSERT(parser.checkpoints.back() == tokenIndex);
+    parser.checkpoints.pop_back();
+}
+
+void Parser::Checkpoint::backtrack() {
+    parser.currentTokenIndex = tokenIndex;
+}
+
+Token& Parser::getBufferedToken(size_t tokenIndex) {
+    ASSERT(tokenIndex >= firstBufferedTokenIndex && tokenIndex < endBufferedTokenIndex);
+    return tokenBuffer[tokenIndex & (tokenBuffer.size() - 1)];
+}
+
+/// Makes room for one more token at the end of the token buffer, by dropping the tokens that can no longer be needed, or if none
+/// can be dropped, by doubling the buffer's capacity.
+void Parser::reserveTokenBufferSlot() {
+    // Checkpoints are created in token order, so the first one is the oldest. The token before it is kept too, because it becomes
+    // the previous token again when the parser backtracks to the checkpoint.
+    auto getPreviousTokenIndex = [](size_t tokenIndex) { return tokenIndex > 0 ? tokenIndex - 1 : 0; };
+    size_t firstNeededTokenIndex = getPreviousTokenIndex(currentTokenIndex);
+    if (!checkpoints.empty()) firstNeededTokenIndex = std::min(firstNeededTokenIndex, getPreviousTokenIndex(checkpoints.front()));
+    firstBufferedTokenIndex = std::max(firstBufferedTokenIndex, firstNeededTokenIndex);
+
+    if (endBufferedTokenIndex - firstBufferedTokenIndex < tokenBuffer.size()) return;
+
+    std::vector<Token> newTokenBuffer(tokenBuffer.size() * 2);
+    for (size_t i = firstBufferedTokenIndex; i < endBufferedTokenIndex; ++i) {
+        newTokenBuffer[i & (newTokenBuffer.size() - 1)] = getBufferedToken(i);
+    }
+    tokenBuffer = std::move(newTokenBuffer);
+}
+
+void Parser::lexTokensUntil(size_t tokenIndex) {
+    while (endBufferedTokenIndex <= tokenIndex) {
+        reserveTokenBufferSlot();
+        try {
+            tokenBuffer[endBufferedTokenIndex & (tokenBuffer.size() - 1)] = lexer.nextToken();
+        } catch (const CompileError&) {
+            hasLexerError = true;
+            throw;
+        }
+        endBufferedTokenIndex++;
+    }
+}
+
+/// Inserts a token that wasn't produced by the lexer before the given buffered token, shifting the tokens after it forward.
+void Parser::insertToken(size_t tokenIndex, Token token) {
+    ASSERT(tokenIndex >= firstBufferedTokenIndex && tokenIndex <= endBufferedTokenIndex);
+    reserveTokenBufferSlot();
+    endBufferedTokenIndex++;
+    for (size_t i = endBufferedTokenIndex - 1; i > tokenIndex; --i) {
+        getBufferedToken(i) = getBufferedToken(i - 1);
+    }
+    getBufferedToken(tokenIndex) = token;
 }
 
 Token Parser::currentToken() {
-    ASSERT(currentTokenIndex < tokenBuffer.size());
-    return tokenBuffer[currentTokenIndex];
+    return getBufferedToken(currentTokenIndex);
 }
 
 SourceLocation Parser::getCurrentLocation() {
@@ -42,18 +118,14 @@ SourceLocation Parser::getCurrentLocation() {
 
 Token Parser::lookAhead(int offset) {
     if (int(currentTokenIndex) + offset < 0) return Token(Token::None, SourceLocation());
-    int count = int(currentTokenIndex) + offset - int(tokenBuffer.size()) + 1;
-    while (count-- > 0) {
-        tokenBuffer.emplace_back(lexer.nextToken());
-    }
-    return tokenBuffer[currentTokenIndex + offset];
+    size_t tokenIndex = currentTokenIndex + offset;
+    lexTokensUntil(tokenIndex);
+    return getBufferedToken(tokenIndex);
 }
 
 Token Parser::consumeToken() {
     Token token = currentToken();
-    if (currentTokenIndex + 1 == tokenBuffer.size()) {
-        tokenBuffer.emplace_back(lexer.nextToken());
-    }
+    lexTokensUntil(currentTokenIndex + 1);
     currentTokenIndex++;
     return token;
 }
@@ -100,6 +172,69 @@ static std::string formatList(llvm::ArrayRef<Token::Kind> tokens) {
     }
 }
 
+/// Reports a syntax error caught while parsing the construct that started at the given token, and skips to the next point where
+/// parsing can resume. Returns false if parsing can't continue in this file, because the rest of it can't be tokenized or the
+/// error was at the end of the file, in which case the caller should rethrow the error.
+bool Parser::recoverFromSyntaxError(const CompileError& error, size_t startTokenIndex, bool isTopLevel) {
+    if (hasLexerError || currentToken() == Token::None) return false;
+    error.print();
+    hasSyntaxErrors = true;
+    skipToSyncPoint(startTokenIndex, isTopLevel);
+    return true;
+}
+
+/// Skips tokens up to the next synchronization point: after a ';', before a token that starts a line (or at the top level, a
+/// declaration or preprocessor directive), or before the '}' closing the enclosing block. Brackets opened in the skipped tokens
+/// are matched, so the '}' of a nested block isn't taken for a synchronization point. At the top level, stray '}'s are skipped.
+/// At least one token is skipped if the erroneous construct hasn't consumed any, so that the caller always makes progress.
+void Parser::skipToSyncPoint(size_t startTokenIndex, bool isTopLevel) {
+    int nestLevel = 0;
+
+    while (currentToken() != Token::None) {
+        if (nestLevel == 0) {
+            bool madeProgress = currentTokenIndex > startTokenIndex;
+
+            switch (currentToken()) {
+                case Token::Semicolon:
+                    consumeToken();
+                    return;
+                case Token::RightBrace:
+                    if (!isTopLevel) return;
+                    break;
+                case Token::Struct:
+                case Token::Interface:
+                case Token::Enum:
+                case Token::Import:
+                case Token::Extern:
+                case Token::HashIf:
+                case Token::HashElse:
+                case Token::HashEndif:
+                    if (isTopLevel && madeProgress) return;
+                    break;
+                default:
+                    break;
+            }
+
+            if (madeProgress && currentToken().isAtStartOfLine()) return;
+        }
+
+        switch (consumeToken()) {
+            case Token::LeftParen:
+            case Token::LeftBracket:
+            case Token::LeftBrace:
+                nestLevel++;
+                break;
+            case Token::RightParen:
+            case Token::RightBracket:
+            case Token::RightBrace:
+                if (nestLevel > 0) nestLevel--;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
 Token Parser::parse(llvm::ArrayRef<Token::Kind> expected, const char* contextInfo) {
     if (!llvm::is_contained(expected, currentToken())) {
         unexpectedToken(currentToken(), expected, contextInfo);
@@ -108,7 +243,7 @@ Token Parser::parse(llvm::ArrayRef<Token::Kind> expected, const char* contextInf
 }
 
 void Parser::parseStmtTerminator(const char* contextInfo) {
-    if (getCurrentLocation().line != lookAhead(-1).getLocation().line) return;
+    if (currentToken().isAtStartOfLine()) return;
 
     switch (currentToken()) {
         case Token::RightBrace:
@@ -156,12 +291,12 @@ std::vector<NamedValue> Parser::parseArgumentList(bool allowEmpty) {
 VarExpr* Parser::parseVarExpr() {
     ASSERT(currentToken() == Token::Identifier);
     auto id = consumeToken();
-    return new VarExpr(id.getString().str(), id.getLocation());
+    return new VarExpr(id.getIdentifier(), id.getLocation());
 }
 
 VarExpr* Parser::parseThis() {
     ASSERT(currentToken() == Token::This);
-    auto expr = new VarExpr("this", getCurrentLocation());
+    auto expr = new VarExpr(Identifier("this"), getCurrentLocation());
     consumeToken();
     return expr;
 }
@@ -197,8 +332,7 @@ static std::string replaceEscapeChars(llvm::StringRef literalContent, SourceLoca
                     result += '\\';
                     break;
                 default:
-                    auto itColumn = literalStartLocation.column + 1 + (it - literalContent.begin());
-                    SourceLocation itLocation(literalStartLocation.file, literalStartLocation.line, itColumn);
+                    auto itLocation = literalStartLocation.getLocationWithOffset(int32_t(1 + (it - literalContent.begin())));
                     ERROR(itLocation, "unknown escape character '\\" << *it << "'");
             }
             continue;
@@ -314,8 +448,9 @@ std::vector<Type> Parser::parseNonEmptyTypeList() {
             consumeToken();
         } else {
             if (currentToken() == Token::RightShift) {
-                tokenBuffer[currentTokenIndex] = Token(Token::Greater, currentToken().getLocation());
-                tokenBuffer.insert(tokenBuffer.begin() + currentTokenIndex + 1, Token(Token::Greater, currentToken().getLocation().nextColumn()));
+                auto location = currentToken().getLocation();
+                getBufferedToken(currentTokenIndex) = Token(Token::Greater, location);
+                insertToken(currentTokenIndex + 1, Token(Token::Greater, location.nextColumn()));
             }
             return types;
         }
@@ -343,7 +478,7 @@ Type Parser::parseArrayType(Type elementType) {
         }
         case Token::RightBracket:
             consumeToken();
-            return BasicType::get("ArrayRef", elementType);
+            return BasicType::get(Identifier("ArrayRef"), elementType);
 
         case Token::Star:
             consumeToken();
@@ -365,9 +500,9 @@ Type Parser::parseSimpleType(Mutability mutability) {
             genericArgs = parseGenericArgumentList();
             LLVM_FALLTHROUGH;
         default:
-            return BasicType::get(identifier.getString(), std::move(genericArgs), mutability, identifier.getLocation());
+            return BasicType::get(identifier.getIdentifier(), std::move(genericArgs), mutability, identifier.getLocation());
         case Token::LeftBracket:
-            return parseArrayType(BasicType::get(identifier.getString(), {}, mutability, identifier.getLocation()));
+            return parseArrayType(BasicType::get(identifier.getIdentifier(), {}, mutability, identifier.getLocation()));
     }
 }
 
@@ -523,13 +658,14 @@ LambdaExpr* Parser::parseLambdaExpr() {
 
     if (currentToken() == Token::Identifier) {
         auto paramName = consumeToken();
-        params.push_back(ParamDecl(Type(), paramName.getString().str(), false, paramName.getLocation()));
+        params.push_back(ParamDecl(Type(), paramName.getIdentifier(), false, paramName.getLocation()));
     } else {
         params = parseParamList(nullptr, false);
     }
 
     parse(Token::RightArrow);
     auto lambda = new LambdaExpr(std::move(params), currentModule, location);
+    lambdas.push_back(lambda);
 
     if (currentToken() == Token::LeftBrace) {
         lambda->functionDecl->setBody(parseBlock(lambda->functionDecl));
@@ -565,14 +701,14 @@ bool Parser::shouldParseVarStmt() {
                     return true;
                 }
                 if (lookAhead(offset - 2).is(Token::Star)) {
-                    if (lookAhead(offset - 3).is(Token::Semicolon) || lookAhead(offset - 2).getLocation().line != lookAhead(offset - 3).getLocation().line) {
+                    if (lookAhead(offset - 3).is(Token::Semicolon) || lookAhead(offset - 2).isAtStartOfLine()) {
                         return false;
                     }
                     return true;
                 }
             }
             return false;
-        } else if (lookAhead(offset).is(Token::Semicolon) || lookAhead(offset).getLocation().line != lookAhead(offset - 1).getLocation().line) {
+        } else if (lookAhead(offset).is(Token::Semicolon) || lookAhead(offset).isAtStartOfLine()) {
             if (lookAhead(offset - 1).is(Token::Identifier)) {
                 if (lookAhead(offset - 2).is({ Token::Identifier, Token::RightBracket, Token::QuestionMark, Token::Greater, Token::Star })) {
                     return true;
@@ -589,8 +725,8 @@ bool Parser::shouldParseGenericArgumentList() {
     // Temporary hack: use spacing to determine whether to parse a generic argument list
     // of a less-than binary expression. Zero spaces on either side of '<' will cause it
     // to be interpreted as a generic argument list, for now.
-    return lookAhead(0).getLocation().column + int(lookAhead(0).getString().size()) == lookAhead(1).getLocation().column ||
-           lookAhead(1).getLocation().column + 1 == lookAhead(2).getLocation().column;
+    return lookAhead(0).getLocation().getLocationWithOffset(int32_t(lookAhead(0).getString().size())) == lookAhead(1).getLocation() ||
+           lookAhead(1).getLocation().nextColumn() == lookAhead(2).getLocation();
 }
 
 /// Returns true if a right-arrow token immediately follows the current set of parentheses.
@@ -740,12 +876,12 @@ Expr* Parser::parseBinaryExpr(int minPrecedence) {
             continue;
         }
 
-        auto backtrackLocation = currentTokenIndex;
+        Checkpoint checkpoint(*this);
         auto op = consumeToken();
         auto rhs = parseBinaryExpr(getPrecedence(op) + 1);
 
         if (isAssignmentOperator(currentToken())) {
-            currentTokenIndex = backtrackLocation;
+            checkpoint.backtrack();
             break;
         }
 
@@ -818,21 +954,21 @@ VarDecl* Parser::parseVarDecl(Decl* parent, AccessLevel accessLevel) {
     }
 
     auto name = parse(Token::Identifier);
-    return parseVarDeclAfterName(parent, accessLevel, type.withMutability(mutability), name.getString(), name.getLocation());
+    return parseVarDeclAfterName(parent, accessLevel, type.withMutability(mutability), name.getIdentifier(), name.getLocation());
 }
 
-VarDecl* Parser::parseVarDeclAfterName(Decl* parent, AccessLevel accessLevel, Type type, llvm::StringRef name, SourceLocation nameLocation) {
+VarDecl* Parser::parseVarDeclAfterName(Decl* parent, AccessLevel accessLevel, Type type, Identifier name, SourceLocation nameLocation) {
     Expr* initializer = nullptr;
 
     if (currentToken() == Token::Assignment) {
         consumeToken();
         initializer = parseExpr();
-    } else if (currentToken() == Token::Semicolon || currentToken().getLocation().line != lookAhead(-1).getLocation().line) {
+    } else if (currentToken() == Token::Semicolon || currentToken().isAtStartOfLine()) {
         WARN(nameLocation, "missing initializer");
     }
 
     parseStmtTerminator();
-    return new VarDecl(type, name.str(), initializer, parent, accessLevel, *currentModule, nameLocation);
+    return new VarDecl(type, name, initializer, parent, accessLevel, *currentModule, nameLocation);
 }
 
 /// var-stmt ::= var-decl
@@ -852,7 +988,7 @@ std::vector<Stmt*> Parser::parseBlock(Decl* parent) {
     parse(Token::LeftBrace);
     std::vector<Stmt*> stmts;
     while (currentToken() != Token::RightBrace) {
-        stmts.push_back(parseStmt(parent));
+        stmts.push_back(parseStmtOrRecover(parent));
     }
     consumeToken();
     return stmts;
@@ -958,7 +1094,7 @@ SwitchStmt* Parser::parseSwitchStmt(Decl* parent) {
                 consumeToken();
                 auto name = parse(Token::Identifier);
                 // TODO: UndefinedLiteralExpr as initializer is a hack, should be nullptr.
-                associatedValue = new VarDecl(Type(), name.getString().str(), new UndefinedLiteralExpr(name.getLocation()), parent, AccessLevel::None,
+                associatedValue = new VarDecl(Type(), name.getIdentifier(), new UndefinedLiteralExpr(name.getLocation()), parent, AccessLevel::None,
                                               *currentModule, name.getLocation());
             }
 
@@ -1037,10 +1173,24 @@ Stmt* Parser::parseStmt(Decl* parent) {
     }
 }
 
+/// Parses a statement, or if it contains a syntax error, reports the error and returns an ErrorStmt in its place after skipping
+/// to the next statement.
+Stmt* Parser::parseStmtOrRecover(Decl* parent) {
+    auto startTokenIndex = currentTokenIndex;
+    auto location = getCurrentLocation();
+
+    try {
+        return parseStmt(parent);
+    } catch (const CompileError& error) {
+        if (!recoverFromSyntaxError(error, startTokenIndex, false)) throw;
+        return new ErrorStmt(location);
+    }
+}
+
 std::vector<Stmt*> Parser::parseStmtsUntilOneOf(Token::Kind end1, Token::Kind end2, Token::Kind end3, Decl* parent) {
     std::vector<Stmt*> stmts;
     while (currentToken() != end1 && currentToken() != end2 && currentToken() != end3) {
-        stmts.emplace_back(parseStmt(parent));
+        stmts.emplace_back(parseStmtOrRecover(parent));
     }
     return stmts;
 }
@@ -1056,7 +1206,7 @@ ParamDecl Parser::parseParam(bool requireType) {
     }
 
     auto name = parse(Token::Identifier);
-    return ParamDecl(type, name.getString().str(), isPublic, name.getLocation());
+    return ParamDecl(type, name.getIdentifier(), isPublic, name.getLocation());
 }
 
 /// param-list ::= '(' params ')'
@@ -1082,7 +1232,7 @@ void Parser::parseGenericParamList(std::vector<GenericParamDecl>& genericParams)
     parse(Token::Less);
     while (true) {
         auto genericParamName = parse(Token::Identifier);
-        genericParams.emplace_back(genericParamName.getString().str(), genericParamName.getLocation());
+        genericParams.emplace_back(genericParamName.getIdentifier(), genericParamName.getLocation());
 
         if (currentToken() == Token::Colon) {
             consumeToken();
@@ -1095,7 +1245,7 @@ void Parser::parseGenericParamList(std::vector<GenericParamDecl>& genericParams)
     parse(Token::Greater);
 }
 
-llvm::StringRef Parser::parseFunctionName(TypeDecl* receiverTypeDecl) {
+Identifier Parser::parseFunctionName(TypeDecl* receiverTypeDecl) {
     auto name = parse(Token::Identifier);
 
     if (name.getString() == "operator") {
@@ -1104,9 +1254,9 @@ llvm::StringRef Parser::parseFunctionName(TypeDecl* receiverTypeDecl) {
             parse(Token::RightBracket);
             if (currentToken() == Token::Assignment) {
                 consumeToken();
-                return "[]=";
+                return Identifier("[]=");
             } else {
-                return "[]";
+                return Identifier("[]");
             }
         } else {
             if (!isOverloadable(op)) {
@@ -1118,20 +1268,20 @@ llvm::StringRef Parser::parseFunctionName(TypeDecl* receiverTypeDecl) {
             return toString(op);
         }
     } else {
-        return name.getString();
+        return name.getIdentifier();
     }
 }
 
 /// function-proto ::= type id param-list
 FunctionDecl* Parser::parseFunctionProto(bool isExtern, TypeDecl* receiverTypeDecl, AccessLevel accessLevel, std::vector<GenericParamDecl>* genericParams,
-                                         Type returnType, llvm::StringRef name, SourceLocation location) {
+                                         Type returnType, Identifier name, SourceLocation location) {
     if (currentToken() == Token::Less) {
         parseGenericParamList(*genericParams);
     }
 
     bool isVariadic = false;
     auto params = parseParamList(isExtern ? &isVariadic : nullptr);
-    FunctionProto proto(name.str(), std::move(params), returnType, isVariadic, isExtern);
+    FunctionProto proto(name, std::move(params), returnType, isVariadic, isExtern);
 
     if (receiverTypeDecl) {
         return new MethodDecl(std::move(proto), *receiverTypeDecl, std::vector<Type>(), accessLevel, location);
@@ -1143,19 +1293,45 @@ FunctionDecl* Parser::parseFunctionProto(bool isExtern, TypeDecl* receiverTypeDe
 /// function-template-proto ::= type id template-param-list param-list
 /// template-param-list ::= '<' template-param-decls '>'
 /// template-param-decls ::= id | id ',' template-param-decls
-FunctionTemplate* Parser::parseFunctionTemplateProto(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, Type type, llvm::StringRef name,
+FunctionTemplate* Parser::parseFunctionTemplateProto(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, Type type, Identifier name,
                                                      SourceLocation location) {
     std::vector<GenericParamDecl> genericParams;
     auto decl = parseFunctionProto(false, receiverTypeDecl, accessLevel, &genericParams, type, name, location);
     return new FunctionTemplate(std::move(genericParams), decl, accessLevel);
 }
 
+/// Skips the function body starting at the current '{' by matching braces, recording its location so that it can be parsed with
+/// parseLazyFunctionBody() once the function is used.
+void Parser::skipFunctionBody(FunctionDecl& decl) {
+    ASSERT(currentToken() == Token::LeftBrace);
+    decl.setLazyBody(getCurrentLocation());
+    int nestLevel = 0;
+
+    do {
+        switch (currentToken()) {
+            case Token::LeftBrace:
+                nestLevel++;
+                break;
+            case Token::RightBrace:
+                nestLevel--;
+                break;
+            case Token::None:
+                unexpectedToken(currentToken(), Token::RightBrace);
+            default:
+                break;
+        }
+        consumeToken();
+    } while (nestLevel > 0);
+}
+
 /// function-decl ::= function-proto '{' stmt* '}'
-FunctionDecl* Parser::parseFunctionDecl(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, bool requireBody, Type type, llvm::StringRef name,
+FunctionDecl* Parser::parseFunctionDecl(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, bool requireBody, Type type, Identifier name,
                                         SourceLocation location) {
     auto decl = parseFunctionProto(false, receiverTypeDecl, accessLevel, nullptr, type, name, location);
 
-    if (requireBody || currentToken() == Token::LeftBrace) {
+    if (skipFunctionBodies && currentToken() == Token::LeftBrace) {
+        skipFunctionBody(*decl);
+    } else if (requireBody || currentToken() == Token::LeftBrace) {
         decl->setBody(parseBlock(decl));
     }
 
@@ -1167,14 +1343,14 @@ FunctionDecl* Parser::parseFunctionDecl(TypeDecl* receiverTypeDecl, AccessLevel
 }
 
 /// function-template-decl ::= function-template-proto '{' stmt* '}'
-FunctionTemplate* Parser::parseFunctionTemplate(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, Type type, llvm::StringRef name, SourceLocation location) {
+FunctionTemplate* Parser::parseFunctionTemplate(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, Type type, Identifier name, SourceLocation location) {
     auto decl = parseFunctionTemplateProto(receiverTypeDecl, accessLevel, type, name, location);
     decl->getFunctionDecl()->setBody(parseBlock(decl));
     return decl;
 }
 
 /// extern-function-decl ::= 'extern' function-proto ('\n' | ';')
-FunctionDecl* Parser::parseExternFunctionDecl(Type type, llvm::StringRef name, SourceLocation location) {
+FunctionDecl* Parser::parseExternFunctionDecl(Type type, Identifier name, SourceLocation location) {
     auto decl = parseFunctionProto(true, nullptr, AccessLevel::Default, nullptr, type, name, location);
     parseStmtTerminator();
     return decl;
@@ -1205,7 +1381,7 @@ DestructorDecl* Parser::parseDestructorDecl(TypeDecl& receiverTypeDecl) {
 }
 
 /// field-decl ::= type id ('=' expr)? ('\n' | ';')
-FieldDecl Parser::parseFieldDecl(TypeDecl& typeDecl, AccessLevel accessLevel, Type type, llvm::StringRef name, SourceLocation location) {
+FieldDecl Parser::parseFieldDecl(TypeDecl& typeDecl, AccessLevel accessLevel, Type type, Identifier name, SourceLocation location) {
     Expr* defaultValue = nullptr;
 
     if (currentToken() == Token::Assignment) {
@@ -1214,7 +1390,7 @@ FieldDecl Parser::parseFieldDecl(TypeDecl& typeDecl, AccessLevel accessLevel, Ty
     }
 
     parseStmtTerminator();
-    return FieldDecl(type, name.str(), defaultValue, typeDecl, accessLevel, location);
+    return FieldDecl(type, name, defaultValue, typeDecl, accessLevel, location);
 }
 
 /// type-template-decl ::= ('struct' | 'interface') id generic-param-list? '{' member-decl* '}'
@@ -1255,60 +1431,67 @@ TypeDecl* Parser::parseTypeDecl(std::vector<GenericParamDecl>* genericParams, Ac
             llvm_unreachable("invalid token");
     }
 
+    // Bodies of type template methods are needed for instantiation, and interface methods are copied into implementing types.
+    llvm::SaveAndRestore<bool> setSkipFunctionBodies(skipFunctionBodies, skipFunctionBodies && !genericParams && tag == TypeTag::Struct);
     std::vector<Type> interfaces;
     auto typeName = parseTypeHeader(interfaces, genericParams);
-    auto typeDecl = new TypeDecl(tag, typeName.getString().str(), std::vector<Type>(), std::move(interfaces), typeAccessLevel, *currentModule, nullptr,
+    auto typeDecl = new TypeDecl(tag, typeName.getIdentifier(), std::vector<Type>(), std::move(interfaces), typeAccessLevel, *currentModule, nullptr,
                                  typeName.getLocation());
     bool hasConstructor = false;
     parse(Token::LeftBrace);
 
     while (currentToken() != Token::RightBrace) {
         AccessLevel accessLevel = AccessLevel::Default;
-
-    start:
-        switch (currentToken()) {
-            case Token::Private:
-                if (tag == TypeTag::Interface) {
-                    WARN(getCurrentLocation(), "interface members cannot be private");
-                }
-                if (accessLevel != AccessLevel::Default) {
-                    WARN(getCurrentLocation(), "duplicate access specifier");
-                }
-                accessLevel = AccessLevel::Private;
-                consumeToken();
-                goto start;
-            case Token::Tilde:
-                if (accessLevel != AccessLevel::Default) {
-                    WARN(lookAhead(-1).getLocation(), "destructors cannot be " << accessLevel);
-                }
-                typeDecl->addMethod(parseDestructorDecl(*typeDecl));
-                break;
-            case Token::Identifier:
-                if (lookAhead(1) == Token::LeftParen && currentToken().getString() == typeName.getString()) {
-                    typeDecl->addMethod(parseConstructorDecl(*typeDecl, accessLevel));
-                    hasConstructor = true;
+        auto startTokenIndex = currentTokenIndex;
+
+        try {
+        start:
+            switch (currentToken()) {
+                case Token::Private:
+                    if (tag == TypeTag::Interface) {
+                        WARN(getCurrentLocation(), "interface members cannot be private");
+                    }
+                    if (accessLevel != AccessLevel::Default) {
+                        WARN(getCurrentLocation(), "duplicate access specifier");
+                    }
+                    accessLevel = AccessLevel::Private;
+                    consumeToken();
+                    goto start;
+                case Token::Tilde:
+                    if (accessLevel != AccessLevel::Default) {
+                        WARN(lookAhead(-1).getLocation(), "destructors cannot be " << accessLevel);
+                    }
+                    typeDecl->addMethod(parseDestructorDecl(*typeDecl));
                     break;
-                }
-                LLVM_FALLTHROUGH;
-            default: {
-                auto type = parseType();
-                auto location = getCurrentLocation();
-                auto name = parseFunctionName(&*typeDecl);
-                auto requireBody = tag != TypeTag::Interface;
-
-                switch (currentToken()) {
-                    case Token::LeftParen:
-                        typeDecl->addMethod(parseFunctionDecl(typeDecl, accessLevel, requireBody, type, name, location));
-                        break;
-                    case Token::Less:
-                        typeDecl->addMethod(parseFunctionTemplate(typeDecl, accessLevel, type, name, location));
-                        break;
-                    default:
-                        typeDecl->addField(parseFieldDecl(*typeDecl, accessLevel, type, name, location));
+                case Token::Identifier:
+                    if (lookAhead(1) == Token::LeftParen && currentToken().getString() == typeName.getString()) {
+                        typeDecl->addMethod(parseConstructorDecl(*typeDecl, accessLevel));
+                        hasConstructor = true;
                         break;
+                    }
+                    LLVM_FALLTHROUGH;
+                default: {
+                    auto type = parseType();
+                    auto location = getCurrentLocation();
+                    auto name = parseFunctionName(&*typeDecl);
+                    auto requireBody = tag != TypeTag::Interface;
+
+                    switch (currentToken()) {
+                        case Token::LeftParen:
+                            typeDecl->addMethod(parseFunctionDecl(typeDecl, accessLevel, requireBody, type, name, location));
+                            break;
+                        case Token::Less:
+                            typeDecl->addMethod(parseFunctionTemplate(typeDecl, accessLevel, type, name, location));
+                            break;
+                        default:
+                            typeDecl->addField(parseFieldDecl(*typeDecl, accessLevel, type, name, location));
+                            break;
+                    }
+                    break;
                 }
-                break;
             }
+        } catch (const CompileError& error) {
+            if (!recoverFromSyntaxError(error, startTokenIndex, false)) throw;
         }
     }
 
@@ -1325,12 +1508,12 @@ ConstructorDecl* Parser::createAutogeneratedConstructor(TypeDecl* typeDecl) cons
     std::vector<Stmt*> body;
 
     for (auto& field : typeDecl->getFields()) {
-        auto* left = new MemberExpr(new VarExpr("this", field.getLocation()), field.getName().str(), field.getLocation());
-        auto* right = field.getDefaultValue() ? field.getDefaultValue() : new VarExpr(field.getName().str(), field.getLocation());
+        auto* left = new MemberExpr(new VarExpr(Identifier("this"), field.getLocation()), field.getName().str(), field.getLocation());
+        auto* right = field.getDefaultValue() ? field.getDefaultValue() : new VarExpr(Identifier(field.getName()), field.getLocation());
         body.push_back(new ExprStmt(new BinaryExpr(Token::Assignment, left, right, field.getLocation())));
 
         if (!field.getDefaultValue()) {
-            params.push_back(ParamDecl(field.getType(), field.getName().str(), false, field.getLocation()));
+            params.push_back(ParamDecl(field.getType(), Identifier(field.getName()), false, field.getLocation()));
         }
     }
 
@@ -1366,7 +1549,7 @@ EnumDecl* Parser::parseEnumDecl(AccessLevel typeAccessLevel) {
         }
 
         auto value = new IntLiteralExpr(valueCounter, caseName.getLocation());
-        cases.push_back(EnumCase(caseName.getString().str(), value, associatedType, typeAccessLevel, caseName.getLocation()));
+        cases.push_back(EnumCase(caseName.getIdentifier(), value, associatedType, typeAccessLevel, caseName.getLocation()));
         ++valueCounter;
 
         if (currentToken() == Token::Comma) {
@@ -1377,7 +1560,7 @@ EnumDecl* Parser::parseEnumDecl(AccessLevel typeAccessLevel) {
     }
 
     consumeToken();
-    return new EnumDecl(name.getString().str(), std::move(cases), typeAccessLevel, *currentModule, nullptr, name.getLocation());
+    return new EnumDecl(name.getIdentifier(), std::move(cases), typeAccessLevel, *currentModule, nullptr, name.getLocation());
 }
 
 /// import-decl ::= 'import' (id | string-literal) ('\n' | ';')
@@ -1402,11 +1585,8 @@ void Parser::parseIfdefBody(std::vector<Decl*>* activeDecls) {
     if (currentToken() == Token::HashIf) {
         parseIfdef(activeDecls);
     } else {
-        if (activeDecls) {
-            activeDecls->emplace_back(parseTopLevelDecl(true));
-        } else {
-            parseTopLevelDecl(false);
-        }
+        auto decl = parseTopLevelDeclOrRecover();
+        if (decl && activeDecls) activeDecls->emplace_back(decl);
     }
 }
 
@@ -1452,7 +1632,7 @@ void Parser::parseIfdef(std::vector<Decl*>* activeDecls) {
 
 /// top-level-decl ::= function-decl | extern-function-decl | type-decl | enum-decl | import-decl | var-decl
 /// @throws CompileError
-Decl* Parser::parseTopLevelDecl(bool addToSymbolTable) {
+Decl* Parser::parseTopLevelDecl() {
     AccessLevel accessLevel = AccessLevel::Default;
     Decl* decl = nullptr;
 
@@ -1468,29 +1648,25 @@ start:
                 WARN(lookAhead(-1).getLocation(), "extern functions cannot have access specifiers");
             }
             consumeToken();
-            return parseTopLevelFunctionOrVariable(true, addToSymbolTable, accessLevel);
+            return parseTopLevelFunctionOrVariable(true, accessLevel);
         case Token::Struct:
         case Token::Interface:
             if (lookAhead(2) == Token::Less) {
                 decl = parseTypeTemplate(accessLevel);
-                if (addToSymbolTable) currentModule->addToSymbolTable(llvm::cast<TypeTemplate>(*decl));
             } else {
                 decl = parseTypeDecl(nullptr, accessLevel);
-                if (addToSymbolTable) currentModule->addToSymbolTable(llvm::cast<TypeDecl>(*decl));
             }
             break;
         case Token::Enum:
             decl = parseEnumDecl(accessLevel);
-            if (addToSymbolTable) currentModule->addToSymbolTable(llvm::cast<EnumDecl>(*decl));
             break;
         case Token::Var:
         case Token::Const:
             // Determine if this is a constant declaration or if the const is part of a type.
             if (currentToken() == Token::Const && lookAhead(2) != Token::Assignment) {
-                return parseTopLevelFunctionOrVariable(false, addToSymbolTable, accessLevel);
+                return parseTopLevelFunctionOrVariable(false, accessLevel);
             }
             decl = parseVarDecl(nullptr, accessLevel);
-            if (addToSymbolTable) currentModule->addToSymbolTable(llvm::cast<VarDecl>(*decl));
             break;
         case Token::Import:
             if (accessLevel != AccessLevel::Default) {
@@ -1498,13 +1674,26 @@ start:
             }
             return parseImportDecl();
         default:
-            return parseTopLevelFunctionOrVariable(false, addToSymbolTable, accessLevel);
+            return parseTopLevelFunctionOrVariable(false, accessLevel);
     }
 
     return decl;
 }
 
-Decl* Parser::parseTopLevelFunctionOrVariable(bool isExtern, bool addToSymbolTable, AccessLevel accessLevel) {
+/// Parses a top-level declaration, or if it contains a syntax error, reports the error and returns null after skipping to the
+/// next declaration.
+Decl* Parser::parseTopLevelDeclOrRecover() {
+    auto startTokenIndex = currentTokenIndex;
+
+    try {
+        return parseTopLevelDecl();
+    } catch (const CompileError& error) {
+        if (!recoverFromSyntaxError(error, startTokenIndex, true)) throw;
+        return nullptr;
+    }
+}
+
+Decl* Parser::parseTopLevelFunctionOrVariable(bool isExtern, AccessLevel accessLevel) {
     Decl* decl;
     auto type = parseType();
     auto location = getCurrentLocation();
@@ -1517,22 +1706,19 @@ Decl* Parser::parseTopLevelFunctionOrVariable(bool isExtern, bool addToSymbolTab
             } else {
                 decl = parseFunctionDecl(nullptr, accessLevel, false, type, name, location);
             }
-            if (addToSymbolTable) currentModule->addToSymbolTable(llvm::cast<FunctionDecl>(*decl));
             break;
         case Token::Less:
             decl = parseFunctionTemplate(nullptr, accessLevel, type, name, location);
-            if (addToSymbolTable) currentModule->addToSymbolTable(llvm::cast<FunctionTemplate>(*decl));
             break;
         default:
             decl = parseVarDeclAfterName(nullptr, accessLevel, type, name, location);
-            if (addToSymbolTable) currentModule->addToSymbolTable(llvm::cast<VarDecl>(*decl));
             break;
     }
 
     return decl;
 }
 
-void Parser::parse() {
+SourceFile Parser::parse() {
     std::vector<Decl*> topLevelDecls;
     SourceFile sourceFile(lexer.getFilePath(), currentModule);
 
@@ -1542,7 +1728,7 @@ void Parser::parse() {
                 parseIfdef(&topLevelDecls);
             } else {
                 auto previousTokenIndex = currentTokenIndex;
-                topLevelDecls.push_back(parseTopLevelDecl(true));
+                if (auto* decl = parseTopLevelDeclOrRecover()) topLevelDecls.push_back(decl);
                 if (currentTokenIndex == previousTokenIndex) break;
             }
         }
@@ -1551,5 +1737,70 @@ void Parser::parse() {
     }
 
     sourceFile.setDecls(std::move(topLevelDecls));
-    currentModule->addSourceFile(std::move(sourceFile));
+    return sourceFile;
+}
+
+void cx::parseSourceFiles(llvm::ArrayRef<std::string> paths, Module& module, const CompileOptions& options, bool skipFunctionBodies) {
+    if (options.parseJobs == 1 || paths.size() <= 1) {
+        for (auto& path : paths) {
+            PhaseTimer timer("Parsing", path);
+            Parser parser(path, module, options, skipFunctionBodies);
+            module.addSourceFile(parser.parse());
+            module.addToSymbolTable(module.getSourceFiles().back());
+        }
+        return;
+    }
+
+    struct ParseResult {
+        llvm::Optional<SourceFile> sourceFile;
+        std::vector<LambdaExpr*> lambdas;
+        DiagnosticBuffer diagnostics;
+    };
+
+    std::vector<ParseResult> results(paths.size());
+
+    llvm::ThreadPool threadPool(llvm::hardware_concurrency(options.parseJobs));
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        threadPool.async([&, i] {
+            PhaseTimer timer("Parsing", paths[i]);
+            auto& result = results[i];
+            DiagnosticBufferScope diagnosticBufferScope(result.diagnostics);
+            Parser parser(paths[i], module, options, skipFunctionBodies);
+            result.sourceFile = parser.parse();
+            result.lambdas = parser.getLambdas();
+        });
+    }
+
+    threadPool.wait();
+
+    for (auto& result : results) {
+        result.diagnostics.flush();
+        // Lambda names are numbered in order of creation, so rename them in file order to keep the names deterministic.
+        for (auto* lambda : result.lambdas) {
+            lambda->rename();
+        }
+        module.addSourceFile(std::move(*result.sourceFile));
+        module.addToSymbolTable(module.getSourceFiles().back());
+    }
+}
+
+bool cx::parseLazyFunctionBody(FunctionDecl& decl, const CompileOptions& options) {
+    ASSERT(decl.hasLazyBody());
+    PhaseTimer timer("Parsing", decl.getName());
+    Parser parser(decl.getLazyBodyLocation(), *decl.getModule(), options);
+
+    try {
+        auto body = parser.parseBlock(&decl);
+        if (parser.hasSyntaxErrors) {
+            decl.setBody({});
+            return false;
+        }
+        decl.setBody(std::move(body));
+        return true;
+    } catch (const CompileError& error) {
+        error.print();
+        decl.setBody({});
+        return false;
+    }
 }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <string>
 #include <vector>
 #pragma warning(push, 0)
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/Support/MemoryBuffer.h>
 #pragma warning(pop)
 #include "lex.h"
@@ -71,18 +73,50 @@ struct Token;
 struct Type;
 enum class AccessLevel;
 struct CompileOptions;
+struct CompileError;
 
 struct Parser {
-    Parser(llvm::StringRef filePath, Module& module, const CompileOptions& options);
-    void parse();
+    /// If skipFunctionBodies is true, the bodies of non-template functions are skipped by matching braces, to be parsed with
+    /// parseLazyFunctionBody() only if they're needed.
+    Parser(llvm::StringRef filePath, Module& module, const CompileOptions& options, bool skipFunctionBodies = false);
+    /// Parses the file into a SourceFile of the module, without adding it or its declarations to the module, so that the files of
+    /// a module can be parsed concurrently.
+    SourceFile parse();
+    /// Returns the lambda expressions created while parsing, in source order.
+    llvm::ArrayRef<LambdaExpr*> getLambdas() const { return lambdas; }
 
 private:
+    friend bool parseLazyFunctionBody(FunctionDecl& decl, const CompileOptions& options);
+    Parser(SourceLocation startLocation, Module& module, const CompileOptions& options);
+
+    /// Remembers the current token position so that the parser can backtrack to it after speculatively parsing ahead. The tokens
+    /// from the one before the oldest live checkpoint onwards stay in the token buffer until the checkpoint is destroyed, so that the
+    /// previous token is still there after backtracking.
+    struct Checkpoint {
+        explicit Checkpoint(Parser& parser);
+        ~Checkpoint();
+        Checkpoint(const Checkpoint&) = delete;
+        Checkpoint& operator=(const Checkpoint&) = delete;
+        /// Makes the token at the checkpoint the current token again.
+        void backtrack();
+
+    private:
+        Parser& parser;
+        size_t tokenIndex;
+    };
+
     Token currentToken();
     SourceLocation getCurrentLocation();
     Token lookAhead(int offset);
     Token consumeToken();
+    Token& getBufferedToken(size_t tokenIndex);
+    void lexTokensUntil(size_t tokenIndex);
+    void reserveTokenBufferSlot();
+    void insertToken(size_t tokenIndex, Token token);
     Token parse(llvm::ArrayRef<Token::Kind> expected, const char* contextInfo = nullptr);
     void parseStmtTerminator(const char* contextInfo = nullptr);
+    bool recoverFromSyntaxError(const CompileError& error, size_t startTokenIndex, bool isTopLevel);
+    void skipToSyncPoint(size_t startTokenIndex, bool isTopLevel);
     std::vector<NamedValue> parseArgumentList(bool allowEmpty);
     VarExpr* parseVarExpr();
     VarExpr* parseThis();
@@ -123,7 +157,7 @@ private:
     std::vector<Expr*> parseExprList();
     ReturnStmt* parseReturnStmt();
     VarDecl* parseVarDecl(Decl* parent, AccessLevel accessLevel);
-    VarDecl* parseVarDeclAfterName(Decl* parent, AccessLevel accessLevel, Type type, llvm::StringRef name, SourceLocation nameLocation);
+    VarDecl* parseVarDeclAfterName(Decl* parent, AccessLevel accessLevel, Type type, Identifier name, SourceLocation nameLocation);
     VarStmt* parseVarStmt(Decl* parent);
     ExprStmt* parseExprStmt();
     DeferStmt* parseDeferStmt();
@@ -134,23 +168,25 @@ private:
     BreakStmt* parseBreakStmt();
     ContinueStmt* parseContinueStmt();
     Stmt* parseStmt(Decl* parent);
+    Stmt* parseStmtOrRecover(Decl* parent);
     std::vector<Stmt*> parseBlock(Decl* parent);
     std::vector<Stmt*> parseBlockOrStmt(Decl* parent);
     std::vector<Stmt*> parseStmtsUntilOneOf(Token::Kind end1, Token::Kind end2, Token::Kind end3, Decl* parent);
     ParamDecl parseParam(bool requireType);
     std::vector<ParamDecl> parseParamList(bool* isVariadic, bool requireTypes = true);
     void parseGenericParamList(std::vector<GenericParamDecl>& genericParams);
-    llvm::StringRef parseFunctionName(TypeDecl* receiverTypeDecl);
+    Identifier parseFunctionName(TypeDecl* receiverTypeDecl);
     FunctionDecl* parseFunctionProto(bool isExtern, TypeDecl* receiverTypeDecl, AccessLevel accessLevel, std::vector<GenericParamDecl>* genericParams,
-                                     Type returnType, llvm::StringRef name, SourceLocation location);
-    FunctionTemplate* parseFunctionTemplateProto(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, Type type, llvm::StringRef name, SourceLocation location);
-    FunctionDecl* parseFunctionDecl(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, bool requireBody, Type type, llvm::StringRef name,
+                                     Type returnType, Identifier name, SourceLocation location);
+    FunctionTemplate* parseFunctionTemplateProto(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, Type type, Identifier name, SourceLocation location);
+    void skipFunctionBody(FunctionDecl& decl);
+    FunctionDecl* parseFunctionDecl(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, bool requireBody, Type type, Identifier name,
                                     SourceLocation location);
-    FunctionTemplate* parseFunctionTemplate(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, Type type, llvm::StringRef name, SourceLocation location);
-    FunctionDecl* parseExternFunctionDecl(Type type, llvm::StringRef name, SourceLocation location);
+    FunctionTemplate* parseFunctionTemplate(TypeDecl* receiverTypeDecl, AccessLevel accessLevel, Type type, Identifier name, SourceLocation location);
+    FunctionDecl* parseExternFunctionDecl(Type type, Identifier name, SourceLocation location);
     ConstructorDecl* parseConstructorDecl(TypeDecl& receiverTypeDecl, AccessLevel accessLevel);
     DestructorDecl* parseDestructorDecl(TypeDecl& receiverTypeDecl);
-    FieldDecl parseFieldDecl(TypeDecl& typeDecl, AccessLevel accessLevel, Type type, llvm::StringRef name, SourceLocation location);
+    FieldDecl parseFieldDecl(TypeDecl& typeDecl, AccessLevel accessLevel, Type type, Identifier name, SourceLocation location);
     TypeTemplate* parseTypeTemplate(AccessLevel accessLevel);
     Token parseTypeHeader(std::vector<Type>& interfaces, std::vector<GenericParamDecl>* genericParams);
     TypeDecl* parseTypeDecl(std::vector<GenericParamDecl>* genericParams, AccessLevel typeAccessLevel);
@@ -158,16 +194,37 @@ private:
     ImportDecl* parseImportDecl();
     void parseIfdefBody(std::vector<Decl*>* activeDecls);
     void parseIfdef(std::vector<Decl*>* activeDecls);
-    Decl* parseTopLevelDecl(bool addToSymbolTable);
-    Decl* parseTopLevelFunctionOrVariable(bool isExtern, bool addToSymbolTable, AccessLevel accessLevel);
+    Decl* parseTopLevelDecl();
+    Decl* parseTopLevelDeclOrRecover();
+    Decl* parseTopLevelFunctionOrVariable(bool isExtern, AccessLevel accessLevel);
     ConstructorDecl* createAutogeneratedConstructor(TypeDecl* typeDecl) const;
 
 private:
     Lexer lexer;
     Module* currentModule;
+    /// A ring buffer of the tokens that may still be needed: the previous token, or the token before the oldest checkpoint if there
+    /// is one, up to the furthest token looked ahead to. Tokens are indexed by their position in the file modulo the buffer's capacity,
+    /// which is a power of two and only grows when lookahead or backtracking spans more tokens than fit in it.
     std::vector<Token> tokenBuffer;
+    size_t firstBufferedTokenIndex;
+    size_t endBufferedTokenIndex;
     size_t currentTokenIndex;
+    std::vector<size_t> checkpoints;
     const CompileOptions& options;
+    std::vector<LambdaExpr*> lambdas;
+    bool skipFunctionBodies;
+    /// Set when the lexer reports an error, after which the rest of the file is skipped instead of recovered from.
+    bool hasLexerError;
+    bool hasSyntaxErrors;
 };
 
+/// Parses the given source files into the module, using up to CompileOptions::parseJobs threads. The files are parsed
+/// independently and then added to the module and its symbol table in the given order, so the resulting module and the order
+/// of diagnostics don't depend on the number of jobs.
+void parseSourceFiles(llvm::ArrayRef<std::string> paths, Module& module, const CompileOptions& options, bool skipFunctionBodies = false);
+
+/// Parses the body of a function that was skipped by the parser into the function's module. Returns false if the body contains
+/// a syntax error, which has been reported.
+bool parseLazyFunctionBody(FunctionDecl& decl, const CompileOptions& options);
+
 } // namespace cx
@@ -16,16 +16,23 @@
 #include <clang/Lex/PreprocessorOptions.h>
 #include <clang/Parse/ParseAST.h>
 #include <clang/Sema/Sema.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/ErrorHandling.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
 #pragma warning(pop)
 #include "typecheck.h"
 #include "../ast/decl.h"
 #include "../ast/module.h"
+#include "../ast/source-manager.h"
 #include "../ast/type.h"
 #include "../driver/driver.h"
+#include "../parser/module-interface.h"
+#include "../support/statistics.h"
+#include "../support/time-report.h"
 #include "../support/utility.h"
 
 using namespace cx;
@@ -123,7 +130,7 @@ static Type toCx(clang::QualType qualtype) {
             return toCx(llvm::cast<clang::ElaboratedType>(type).getNamedType());
         case clang::Type::Record: {
             auto* recordDecl = llvm::cast<clang::RecordType>(type).getDecl();
-            return BasicType::get(getName(*recordDecl), {}, mutability);
+            return BasicType::get(Identifier(getName(*recordDecl)), {}, mutability);
         }
         case clang::Type::Paren:
             return toCx(llvm::cast<clang::ParenType>(type).getInnerType());
@@ -157,7 +164,7 @@ static Type toCx(clang::QualType qualtype) {
             if (name.empty()) {
                 return toCx(enumType.getDecl()->getIntegerType());
             } else {
-                return BasicType::get(name, {}, mutability);
+                return BasicType::get(Identifier(name), {}, mutability);
             }
         }
         case clang::Type::Vector: {
@@ -172,12 +179,12 @@ static Type toCx(clang::QualType qualtype) {
 
 static llvm::Optional<FieldDecl> toCx(const clang::FieldDecl& decl, TypeDecl& typeDecl) {
     if (decl.getName().empty()) return llvm::None;
-    return FieldDecl(toCx(decl.getType()), decl.getNameAsString(), nullptr, typeDecl, AccessLevel::Default, SourceLocation());
+    return FieldDecl(toCx(decl.getType()), Identifier(decl.getNameAsString()), nullptr, typeDecl, AccessLevel::Default, SourceLocation());
 }
 
 static TypeDecl* toCx(const clang::RecordDecl& decl, Module* currentModule) {
     auto tag = decl.isUnion() ? TypeTag::Union : TypeTag::Struct;
-    auto* typeDecl = new TypeDecl(tag, getName(decl).str(), {}, {}, AccessLevel::Default, *currentModule, nullptr, SourceLocation());
+    auto* typeDecl = new TypeDecl(tag, Identifier(getName(decl)), {}, {}, AccessLevel::Default, *currentModule, nullptr, SourceLocation());
     typeDecl->packed = decl.hasAttr<clang::PackedAttr>();
 
     for (auto* field : decl.fields()) {
@@ -192,26 +199,34 @@ static TypeDecl* toCx(const clang::RecordDecl& decl, Module* currentModule) {
 }
 
 static VarDecl* toCx(const clang::VarDecl& decl, Module* currentModule) {
-    return new VarDecl(toCx(decl.getType()), decl.getName().str(), nullptr, nullptr, AccessLevel::Default, *currentModule, SourceLocation());
+    return new VarDecl(toCx(decl.getType()), Identifier(decl.getName()), nullptr, nullptr, AccessLevel::Default, *currentModule, SourceLocation());
 }
 
-static void addIntegerConstantToSymbolTable(llvm::StringRef name, llvm::APSInt value, clang::QualType qualType, Module& module) {
+/// Adds the declaration to the module's symbol table and records it for the module cache.
+static void addToSymbolTable(Decl* decl, Module& module, CHeaderDecls& cHeaderDecls) {
+    module.addToSymbolTable(decl);
+    cHeaderDecls.decls.push_back(decl);
+}
+
+static void addIntegerConstantToSymbolTable(llvm::StringRef name, llvm::APSInt value, clang::QualType qualType, Module& module,
+                                            CHeaderDecls& cHeaderDecls) {
     auto initializer = new IntLiteralExpr(std::move(value), SourceLocation());
     auto type = toCx(qualType).withMutability(Mutability::Const);
     initializer->setType(type);
-    module.addToSymbolTable(new VarDecl(type, name.str(), initializer, nullptr, AccessLevel::Default, module, SourceLocation()));
+    addToSymbolTable(new VarDecl(type, Identifier(name), initializer, nullptr, AccessLevel::Default, module, SourceLocation()), module, cHeaderDecls);
 }
 
-static void addFloatConstantToSymbolTable(llvm::StringRef name, llvm::APFloat value, Module& module) {
+static void addFloatConstantToSymbolTable(llvm::StringRef name, llvm::APFloat value, Module& module, CHeaderDecls& cHeaderDecls) {
     auto initializer = new FloatLiteralExpr(std::move(value), SourceLocation());
     auto type = Type::getFloat64(Mutability::Const);
     initializer->setType(type);
-    module.addToSymbolTable(new VarDecl(type, name.str(), initializer, nullptr, AccessLevel::Default, module, SourceLocation()));
+    addToSymbolTable(new VarDecl(type, Identifier(name), initializer, nullptr, AccessLevel::Default, module, SourceLocation()), module, cHeaderDecls);
 }
 
 namespace {
 struct CToCxConverter : clang::ASTConsumer {
-    CToCxConverter(Module& module, clang::SourceManager& sourceManager) : module(module), sourceManager(sourceManager) {}
+    CToCxConverter(Module& module, CHeaderDecls& cHeaderDecls, clang::SourceManager& sourceManager)
+    : module(module), cHeaderDecls(cHeaderDecls), sourceManager(sourceManager) {}
 
     bool HandleTopLevelDecl(clang::DeclGroupRef declGroup) final override {
         for (clang::Decl* decl : declGroup) {
@@ -219,7 +234,7 @@ struct CToCxConverter : clang::ASTConsumer {
                 case clang::Decl::Function: {
                     auto functionDecl = toCx(*llvm::cast<clang::FunctionDecl>(decl), &module);
                     if (module.getSymbolTable().find(functionDecl->getName()).empty()) {
-                        module.addToSymbolTable(functionDecl);
+                        addToSymbolTable(functionDecl, module, cHeaderDecls);
                     }
                     break;
                 }
@@ -227,7 +242,7 @@ struct CToCxConverter : clang::ASTConsumer {
                     if (!decl->isFirstDecl()) break;
                     auto typeDecl = ::toCx(llvm::cast<clang::RecordDecl>(*decl), &module);
                     if (typeDecl && module.getSymbolTable().find(typeDecl->getName()).empty()) {
-                        module.addToSymbolTable(typeDecl);
+                        addToSymbolTable(typeDecl, module, cHeaderDecls);
                     }
                     break;
                 }
@@ -240,21 +255,23 @@ struct CToCxConverter : clang::ASTConsumer {
                         auto enumeratorName = enumerator->getName();
                         auto& value = enumerator->getInitVal();
                         auto valueExpr = new IntLiteralExpr(value, SourceLocation());
-                        cases.push_back(EnumCase(enumeratorName.str(), valueExpr, Type(), AccessLevel::Default, SourceLocation()));
-                        addIntegerConstantToSymbolTable(enumeratorName, value, type, module);
+                        cases.push_back(EnumCase(Identifier(enumeratorName), valueExpr, Type(), AccessLevel::Default, SourceLocation()));
+                        addIntegerConstantToSymbolTable(enumeratorName, value, type, module, cHeaderDecls);
                     }
 
-                    module.addToSymbolTable(new EnumDecl(getName(enumDecl).str(), std::move(cases), AccessLevel::Default, module, nullptr, SourceLocation()));
+                    addToSymbolTable(new EnumDecl(Identifier(getName(enumDecl)), std::move(cases), AccessLevel::Default, module, nullptr, SourceLocation()),
+                                     module, cHeaderDecls);
                     break;
                 }
                 case clang::Decl::Var:
-                    module.addToSymbolTable(::toCx(llvm::cast<clang::VarDecl>(*decl), &module));
+                    addToSymbolTable(::toCx(llvm::cast<clang::VarDecl>(*decl), &module), module, cHeaderDecls);
                     break;
                 case clang::Decl::Typedef: {
                     auto& typedefDecl = llvm::cast<clang::TypedefDecl>(*decl);
                     auto type = ::toCx(typedefDecl.getUnderlyingType());
                     if (type.isBasicType()) {
-                        llvm::cast<BasicType>(BasicType::get(typedefDecl.getName(), {}).getBase())->setName(type.getName().str());
+                        llvm::cast<BasicType>(BasicType::get(Identifier(typedefDecl.getName()), {}).getBase())->setName(type.getName().str());
+                        cHeaderDecls.typedefs.emplace_back(typedefDecl.getName().str(), type.getName().str());
                     } else {
                         // TODO: Import non-BasicType typedefs from C headers.
                     }
@@ -268,27 +285,48 @@ struct CToCxConverter : clang::ASTConsumer {
     }
 
     FunctionDecl* toCx(const clang::FunctionDecl& decl, Module* currentModule) {
-        auto params = map(decl.parameters(),
-                          [](clang::ParmVarDecl* param) { return ParamDecl(::toCx(param->getType()), param->getNameAsString(), false, SourceLocation()); });
-        FunctionProto proto(decl.getNameAsString(), std::move(params), ::toCx(decl.getReturnType()), decl.isVariadic(), true);
+        auto params = map(decl.parameters(), [](clang::ParmVarDecl* param) {
+            return ParamDecl(::toCx(param->getType()), Identifier(param->getNameAsString()), false, SourceLocation());
+        });
+        FunctionProto proto(Identifier(decl.getNameAsString()), std::move(params), ::toCx(decl.getReturnType()), decl.isVariadic(), true);
         if (auto asmLabelAttr = decl.getAttr<clang::AsmLabelAttr>()) {
             proto.asmLabel = asmLabelAttr->getLabel().str();
         }
         return new FunctionDecl(std::move(proto), {}, AccessLevel::Default, *currentModule, toCx(decl.getLocation()));
     }
 
+    /// Maps the location to the same offset in the header, which is only reserved in the cx::SourceManager, so that headers
+    /// aren't read again and their line tables are only built for locations that end up in diagnostics.
     SourceLocation toCx(clang::SourceLocation location) {
-        auto presumedLocation = sourceManager.getPresumedLoc(location);
-        return SourceLocation(strdup(presumedLocation.getFilename()), presumedLocation.getLine(), presumedLocation.getColumn());
+        if (location.isInvalid()) return SourceLocation();
+        auto [clangFile, offset] = sourceManager.getDecomposedExpansionLoc(location);
+
+        auto it = fileStartLocations.find(clangFile);
+        if (it == fileStartLocations.end()) {
+            SourceLocation startLocation;
+            if (auto* fileEntry = sourceManager.getFileEntryForID(clangFile)) {
+                if (auto file = cx::SourceManager::get().reserveFile(fileEntry->getName())) {
+                    startLocation = cx::SourceManager::get().getStartLocation(*file);
+                }
+            }
+            it = fileStartLocations.try_emplace(clangFile, startLocation).first;
+        }
+
+        if (!it->second.isValid()) return SourceLocation();
+        return it->second.getLocationWithOffset(int32_t(offset));
     }
 
 private:
     Module& module;
+    CHeaderDecls& cHeaderDecls;
     clang::SourceManager& sourceManager;
+    /// The locations of the starts of the headers, by their Clang file IDs.
+    llvm::DenseMap<clang::FileID, SourceLocation> fileStartLocations;
 };
 
 struct MacroImporter : clang::PPCallbacks {
-    MacroImporter(Module& module, clang::CompilerInstance& compilerInstance) : module(module), compilerInstance(compilerInstance) {}
+    MacroImporter(Module& module, CHeaderDecls& cHeaderDecls, clang::CompilerInstance& compilerInstance)
+    : module(module), cHeaderDecls(cHeaderDecls), compilerInstance(compilerInstance) {}
 
     void MacroDefined(const clang::Token& name, const clang::MacroDirective* macro) final override {
         if (macro->getMacroInfo()->getNumTokens() != 1) return;
@@ -296,7 +334,8 @@ struct MacroImporter : clang::PPCallbacks {
 
         switch (token.getKind()) {
             case clang::tok::identifier:
-                module.addIdentifierReplacement(name.getIdentifierInfo()->getName(), token.getIdentifierInfo()->getName());
+                module.addIdentifierReplacement(Identifier(name.getIdentifierInfo()->getName()), Identifier(token.getIdentifierInfo()->getName()));
+                cHeaderDecls.identifierReplacements.emplace_back(name.getIdentifierInfo()->getName().str(), token.getIdentifierInfo()->getName().str());
                 break;
             case clang::tok::numeric_constant:
                 importMacroConstant(name.getIdentifierInfo()->getName(), token);
@@ -314,14 +353,15 @@ private:
 
         if (auto* intLiteral = llvm::dyn_cast<clang::IntegerLiteral>(parsed)) {
             llvm::APSInt value(intLiteral->getValue(), parsed->getType()->isUnsignedIntegerType());
-            addIntegerConstantToSymbolTable(name, std::move(value), parsed->getType(), module);
+            addIntegerConstantToSymbolTable(name, std::move(value), parsed->getType(), module, cHeaderDecls);
         } else if (auto* floatLiteral = llvm::dyn_cast<clang::FloatingLiteral>(parsed)) {
-            addFloatConstantToSymbolTable(name, floatLiteral->getValue(), module);
+            addFloatConstantToSymbolTable(name, floatLiteral->getValue(), module, cHeaderDecls);
         }
     }
 
 private:
     Module& module;
+    CHeaderDecls& cHeaderDecls;
     clang::CompilerInstance& compilerInstance;
 };
 } // namespace
@@ -333,13 +373,36 @@ bool cx::importCHeader(SourceFile& importer, llvm::StringRef headerName, const C
         return true;
     }
 
+    PhaseTimer timer("C header import", headerName);
+    std::string cHeaderInterfacePath;
+
+    if (!options.moduleCacheDirectory.empty()) {
+        auto importerDirectory = llvm::sys::path::parent_path(importer.getFilePath());
+        cHeaderInterfacePath = getCHeaderInterfacePath(options.moduleCacheDirectory, headerName, importerDirectory, options);
+        auto module = std::make_unique<Module>(headerName);
+        bool cached = readCHeaderInterface(*module, cHeaderInterfacePath);
+        addStatistic("C header cache", llvm::Twine(cached ? "hit  " : "miss ") + headerName);
+        if (cached) {
+            importer.addImportedModule(module.get());
+            Module::getAllImportedModulesMap()[module->getName()] = module.get();
+            module.release();
+            return true;
+        }
+    }
+
     clang::CompilerInstance ci;
     ci.createDiagnostics();
     auto args = map(options.cflags, [](auto& cflag) { return cflag.c_str(); });
     clang::CompilerInvocation::CreateFromArgs(ci.getInvocation(), args, ci.getDiagnostics());
 
     std::shared_ptr<clang::TargetOptions> pto = std::make_shared<clang::TargetOptions>();
-    pto->Triple = llvm::sys::getDefaultTargetTriple();
+    pto->Triple = options.targetTriple.empty() ? llvm::sys::getDefaultTargetTriple() : options.targetTriple;
+    pto->CPU = options.targetCPU;
+    llvm::SmallVector<llvm::StringRef, 32> targetFeatures;
+    llvm::StringRef(options.targetFeatures).split(targetFeatures, ',', -1, false);
+    for (auto feature : targetFeatures) {
+        pto->FeaturesAsWritten.push_back(feature.str());
+    }
     targetInfo = clang::TargetInfo::CreateTargetInfo(ci.getDiagnostics(), pto);
     ci.setTarget(targetInfo);
 
@@ -377,10 +440,11 @@ bool cx::importCHeader(SourceFile& importer, llvm::StringRef headerName, const C
     }
 
     auto module = new Module(headerName);
-    ci.setASTConsumer(std::make_unique<CToCxConverter>(*module, ci.getSourceManager()));
+    CHeaderDecls cHeaderDecls;
+    ci.setASTConsumer(std::make_unique<CToCxConverter>(*module, cHeaderDecls, ci.getSourceManager()));
     ci.createASTContext();
     ci.createSema(clang::TU_Complete, nullptr);
-    pp.addPPCallbacks(std::make_unique<MacroImporter>(*module, ci));
+    pp.addPPCallbacks(std::make_unique<MacroImporter>(*module, cHeaderDecls, ci));
 
     auto fileID = ci.getSourceManager().createFileID(*fileEntry, clang::SourceLocation(), clang::SrcMgr::C_System);
     ci.getSourceManager().setMainFileID(fileID);
@@ -393,6 +457,19 @@ bool cx::importCHeader(SourceFile& importer, llvm::StringRef headerName, const C
         return false;
     }
 
+    std::vector<llvm::StringRef> headerFilePaths;
+    for (auto it = ci.getSourceManager().fileinfo_begin(), end = ci.getSourceManager().fileinfo_end(); it != end; ++it) {
+        headerFilePaths.push_back(it->first->getName());
+    }
+    llvm::sort(headerFilePaths);
+    for (auto headerFilePath : headerFilePaths) {
+        module->addCHeaderFilePath(headerFilePath);
+    }
+
+    if (!cHeaderInterfacePath.empty()) {
+        writeCHeaderInterface(*module, cHeaderDecls, cHeaderInterfacePath);
+    }
+
     importer.addImportedModule(module);
     Module::getAllImportedModulesMap()[module->getName()] = module;
     return true;
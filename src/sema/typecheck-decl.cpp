@@ -5,6 +5,8 @@
 #pragma warning(pop)
 #include "c-import.h"
 #include "../ast/module.h"
+#include "../ast/source-manager.h"
+#include "../parser/parse.h"
 
 using namespace cx;
 
@@ -86,7 +88,7 @@ void Typechecker::typecheckParamDecl(ParamDecl& decl, AccessLevel userAccessLeve
     }
 
     typecheckType(decl.getType(), userAccessLevel);
-    getCurrentModule()->getSymbolTable().add(decl.getName(), &decl);
+    getCurrentModule()->getSymbolTable().add(decl.name, &decl);
 }
 
 static bool allPathsReturn(llvm::ArrayRef<Stmt*> block) {
@@ -139,10 +141,53 @@ void Typechecker::typecheckParams(llvm::MutableArrayRef<ParamDecl> params, Acces
     }
 }
 
+/// Returns the source file of the module that contains the given declaration.
+static SourceFile* getSourceFile(const Decl& decl) {
+    llvm::StringRef filePath = SourceManager::get().getFilePath(decl.getLocation().getFileID());
+
+    for (auto& sourceFile : decl.getModule()->getSourceFiles()) {
+        if (sourceFile.getFilePath() == filePath) {
+            return &sourceFile;
+        }
+    }
+
+    llvm_unreachable("declaration not found in its module");
+}
+
+void Typechecker::setFunctionReferenced(FunctionDecl& decl) {
+    decl.setReferenced(true);
+    if (decl.hasLazyBody()) declsToTypecheck.push_back(&decl);
+}
+
+void Typechecker::setStdlibFunctionsReferenced(llvm::StringRef name) {
+    auto* stdlibModule = Module::getStdlibModule();
+    if (!stdlibModule) return;
+
+    for (auto* decl : stdlibModule->getSymbolTable().find(name)) {
+        if (auto* functionDecl = llvm::dyn_cast<FunctionDecl>(decl)) setFunctionReferenced(*functionDecl);
+    }
+}
+
 void Typechecker::typecheckFunctionDecl(FunctionDecl& decl) {
     if (decl.isTypechecked()) return;
     if (decl.isExtern()) return; // TODO: Typecheck parameters and return type of extern functions.
 
+    if (decl.hasLazyBody()) {
+        // Skipped bodies are parsed and typechecked only once the function is referenced, possibly while typechecking another
+        // module, so switch to the context in which the function was declared.
+        if (!decl.isReferenced()) return;
+
+        if (!parseLazyFunctionBody(decl, options)) {
+            decl.setTypechecked(true);
+            return;
+        }
+
+        llvm::SaveAndRestore setCurrentModule(currentModule, decl.getModule());
+        llvm::SaveAndRestore setCurrentSourceFile(currentSourceFile, getSourceFile(decl));
+        typecheckFunctionDecl(decl);
+        return;
+    }
+
     TypeDecl* receiverTypeDecl = decl.getTypeDecl();
 
     Scope scope(&decl, &currentModule->getSymbolTable());
@@ -160,7 +205,7 @@ void Typechecker::typecheckFunctionDecl(FunctionDecl& decl) {
 
         if (receiverTypeDecl) {
             Type thisType = receiverTypeDecl->getTypeForPassing();
-            auto* varDecl = new VarDecl(thisType, "this", nullptr, &decl, AccessLevel::None, *getCurrentModule(), decl.getLocation());
+            auto* varDecl = new VarDecl(thisType, Identifier("this"), nullptr, &decl, AccessLevel::None, *getCurrentModule(), decl.getLocation());
             getCurrentModule()->addToSymbolTable(varDecl);
         }
 
@@ -253,7 +298,7 @@ void Typechecker::typecheckTypeDecl(TypeDecl& decl) {
 
     if (decl.isInterface()) {
         // TODO: Move this to typecheckModule to the pre-typechecking phase?
-        realDecl = llvm::cast<TypeDecl>(decl.instantiate({ { "This", decl.getType() } }, {}));
+        realDecl = llvm::cast<TypeDecl>(decl.instantiate({ { Identifier("This"), decl.getType() } }, {}));
     } else {
         realDecl = &decl;
     }
@@ -262,6 +307,11 @@ void Typechecker::typecheckTypeDecl(TypeDecl& decl) {
         typecheckFieldDecl(fieldDecl);
     }
 
+    // IR generation calls destructors implicitly, without references to them in the AST.
+    if (auto* destructor = realDecl->getDestructor(); destructor && destructor->hasLazyBody()) {
+        setFunctionReferenced(*destructor);
+    }
+
     for (auto& methodDecl : realDecl->getMethods()) {
         typecheckMethodDecl(*methodDecl);
     }
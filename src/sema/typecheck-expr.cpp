@@ -17,8 +17,7 @@
 using namespace cx;
 
 void Typechecker::checkHasAccess(const Decl& decl, SourceLocation location, AccessLevel userAccessLevel) {
-    // FIXME: Compare SourceFile objects instead of file path strings.
-    if (decl.getAccessLevel() == AccessLevel::Private && strcmp(decl.getLocation().file, location.file) != 0) {
+    if (decl.getAccessLevel() == AccessLevel::Private && decl.getLocation().getFileID() != location.getFileID()) {
         WARN(location, "'" << decl.getName() << "' is private");
     } else if (userAccessLevel != AccessLevel::None && decl.getAccessLevel() < userAccessLevel) {
         WARN(location, "using " << decl.getAccessLevel() << " type '" << decl.getName() << "' in " << userAccessLevel << " declaration");
@@ -51,6 +50,7 @@ Type Typechecker::typecheckVarExpr(VarExpr& expr, bool useIsWriteOnly) {
             return llvm::cast<ParamDecl>(decl)->getType();
         case DeclKind::FunctionDecl:
         case DeclKind::MethodDecl:
+            setFunctionReferenced(*llvm::cast<FunctionDecl>(decl));
             return Type(llvm::cast<FunctionDecl>(decl)->getFunctionType(), Mutability::Mutable, SourceLocation());
         case DeclKind::GenericParamDecl:
             llvm_unreachable("cannot refer to generic parameters yet");
@@ -77,7 +77,7 @@ Type Typechecker::typecheckVarExpr(VarExpr& expr, bool useIsWriteOnly) {
 }
 
 Type typecheckStringLiteralExpr(StringLiteralExpr&) {
-    return BasicType::get("string", {});
+    return BasicType::get(Identifier("string"), {});
 }
 
 Type typecheckCharacterLiteralExpr(CharacterLiteralExpr&) {
@@ -372,7 +372,7 @@ bool Typechecker::hasMethod(TypeDecl& type, FunctionDecl& functionDecl) const {
 }
 
 bool Typechecker::providesInterfaceRequirements(TypeDecl& type, TypeDecl& interface, std::string* errorReason) const {
-    auto thisTypeResolvedInterface = llvm::cast<TypeDecl>(interface.instantiate({ { "This", type.getType() } }, {}));
+    auto thisTypeResolvedInterface = llvm::cast<TypeDecl>(interface.instantiate({ { Identifier("This"), type.getType() } }, {}));
 
     for (auto& fieldRequirement : thisTypeResolvedInterface->getFields()) {
         if (!hasField(type, fieldRequirement)) {
@@ -682,10 +682,10 @@ Type Typechecker::findGenericArg(Type argType, Type paramType, llvm::StringRef g
 }
 
 static Type replaceUnresolvedGenericParamsWithPlaceholders(Type type, llvm::ArrayRef<GenericParamDecl> genericParams) {
-    llvm::StringMap<Type> placeholders;
+    llvm::DenseMap<Identifier, Type> placeholders;
 
     for (auto& genericParam : genericParams) {
-        placeholders.try_emplace(genericParam.getName(), UnresolvedType::get());
+        placeholders.try_emplace(genericParam.getIdentifier(), UnresolvedType::get());
     }
 
     return type.resolve(placeholders);
@@ -717,8 +717,8 @@ std::vector<Type> Typechecker::inferGenericArgsFromCallArgs(llvm::ArrayRef<Gener
                     genericArg = maybeGenericArg;
                     genericArgValue = argValue;
                 } else {
-                    Type paramTypeWithGenericArg = paramType.resolve({ { genericParam.getName(), genericArg } });
-                    Type paramTypeWithMaybeGenericArg = paramType.resolve({ { genericParam.getName(), maybeGenericArg } });
+                    Type paramTypeWithGenericArg = paramType.resolve({ { genericParam.getIdentifier(), genericArg } });
+                    Type paramTypeWithMaybeGenericArg = paramType.resolve({ { genericParam.getIdentifier(), maybeGenericArg } });
 
                     if (isImplicitlyConvertible(argValue, argValue->getType(), paramTypeWithGenericArg, true)) {
                         continue;
@@ -772,8 +772,8 @@ void cx::validateGenericArgCount(size_t genericParamCount, llvm::ArrayRef<Type>
     }
 }
 
-llvm::StringMap<Type> Typechecker::getGenericArgsForCall(llvm::ArrayRef<GenericParamDecl> genericParams, CallExpr& call, FunctionDecl* decl, bool returnOnError,
-                                                         Type expectedType) {
+llvm::DenseMap<Identifier, Type> Typechecker::getGenericArgsForCall(llvm::ArrayRef<GenericParamDecl> genericParams, CallExpr& call, FunctionDecl* decl,
+                                                                    bool returnOnError, Type expectedType) {
     ASSERT(!genericParams.empty());
     std::vector<Type> inferredGenericArgs;
     llvm::ArrayRef<Type> genericArgTypes;
@@ -781,14 +781,15 @@ llvm::StringMap<Type> Typechecker::getGenericArgsForCall(llvm::ArrayRef<GenericP
     if (call.getGenericArgs().empty()) {
         if (expectedType && expectedType.isBasicType() && !expectedType.getGenericArgs().empty() &&
             llvm::none_of(expectedType.getGenericArgs(), [](Type t) { return t.isUnresolvedType(); }) &&
-            BasicType::get(expectedType.getName(), {}).getDecl() == (decl->isConstructorDecl() ? decl->getTypeDecl() : decl->getReturnType().getDecl())) {
+            BasicType::get(llvm::cast<BasicType>(expectedType.getBase())->getIdentifier(), {}).getDecl() ==
+                (decl->isConstructorDecl() ? decl->getTypeDecl() : decl->getReturnType().getDecl())) {
             genericArgTypes = expectedType.getGenericArgs();
         } else if (call.getArgs().empty()) {
-            if (returnOnError) return {};
+            if (returnOnError) return llvm::DenseMap<Identifier, Type>();
             ERROR(call.getLocation(), "can't infer generic parameters, please specify them explicitly");
         } else {
             inferredGenericArgs = inferGenericArgsFromCallArgs(genericParams, call, decl->getParams(), returnOnError);
-            if (inferredGenericArgs.empty()) return {};
+            if (inferredGenericArgs.empty()) return llvm::DenseMap<Identifier, Type>();
             ASSERT(inferredGenericArgs.size() == genericParams.size());
             genericArgTypes = inferredGenericArgs;
         }
@@ -796,11 +797,11 @@ llvm::StringMap<Type> Typechecker::getGenericArgsForCall(llvm::ArrayRef<GenericP
         genericArgTypes = call.getGenericArgs();
     }
 
-    llvm::StringMap<Type> genericArgs;
+    llvm::DenseMap<Identifier, Type> genericArgs;
     auto genericArg = genericArgTypes.begin();
 
     for (const GenericParamDecl& genericParam : genericParams) {
-        genericArgs.try_emplace(genericParam.getName(), *genericArg++);
+        genericArgs.try_emplace(genericParam.getIdentifier(), *genericArg++);
     }
 
     return genericArgs;
@@ -818,7 +819,7 @@ Type Typechecker::typecheckBuiltinConversion(CallExpr& expr) {
     }
 
     auto sourceType = typecheckExpr(*expr.getArgs().front().getValue());
-    auto targetType = BasicType::get(expr.getFunctionName(), {});
+    auto targetType = BasicType::get(Identifier(expr.getFunctionName()), {});
 
     if (sourceType == targetType) {
         WARN(expr.getCallee().getLocation(), "unnecessary conversion to same type");
@@ -889,12 +890,12 @@ static const Match* resolveAmbiguousOverload(llvm::ArrayRef<Match> matches, cons
     }
 }
 
-static bool equals(const llvm::StringMap<Type>& a, const llvm::StringMap<Type>& b) {
+static bool equals(const llvm::DenseMap<Identifier, Type>& a, const llvm::DenseMap<Identifier, Type>& b) {
     if (a.size() != b.size()) return false;
 
     for (auto& aEntry : a) {
-        auto bEntry = b.find(aEntry.getKey());
-        if (bEntry == b.end() || aEntry.getValue() != bEntry->getValue()) return false;
+        auto bEntry = b.find(aEntry.first);
+        if (bEntry == b.end() || aEntry.second != bEntry->second) return false;
     }
 
     return true;
@@ -942,7 +943,7 @@ Decl* Typechecker::resolveOverload(llvm::ArrayRef<Decl*> decls, CallExpr& expr,
 
                 // TODO: Figure out where to perform this.
                 if (functionDecl && functionDecl->getTypeDecl() && functionDecl->getTypeDecl()->isInterface()) {
-                    functionDecl = functionDecl->instantiate({ { "This", functionDecl->getTypeDecl()->getType() } }, {});
+                    functionDecl = functionDecl->instantiate({ { Identifier("This"), functionDecl->getTypeDecl()->getType() } }, {});
                 }
 
                 if (decls.size() == 1) {
@@ -982,7 +983,7 @@ Decl* Typechecker::resolveOverload(llvm::ArrayRef<Decl*> decls, CallExpr& expr,
                 ASSERT(decls.size() == 1);
                 candidates = llvm::ArrayRef(reinterpret_cast<Decl**>(constructorDecls.data()), constructorDecls.size());
 
-                std::vector<llvm::StringMap<Type>> genericArgSets;
+                std::vector<llvm::DenseMap<Identifier, Type>> genericArgSets;
 
                 for (auto* constructorDecl : constructorDecls) {
                     auto genericArgs = getGenericArgsForCall(typeTemplate->getGenericParams(), expr, constructorDecl, constructorDecls.size() != 1, expectedType);
@@ -995,7 +996,8 @@ Decl* Typechecker::resolveOverload(llvm::ArrayRef<Decl*> decls, CallExpr& expr,
                 for (auto& genericArgs : genericArgSets) {
                     TypeDecl* typeDecl = nullptr;
 
-                    auto genericArgTypes = map(genericArgs, [](auto& entry) { return entry.getValue(); });
+                    auto genericArgTypes = map(typeTemplate->getGenericParams(),
+                                               [&](auto& genericParam) { return genericArgs.find(genericParam.getIdentifier())->second; });
                     auto typeDecls = findDecls(getQualifiedTypeName(typeTemplate->getTypeDecl()->getName(), genericArgTypes));
 
                     if (typeDecls.empty()) {
@@ -1093,6 +1095,80 @@ Decl* Typechecker::resolveOverload(llvm::ArrayRef<Decl*> decls, CallExpr& expr,
     }
 }
 
+/// Returns true if the argument's type and value category alone determine whether it matches a parameter. Literals, constants,
+/// and conditional, tuple, and array expressions are typechecked against the parameter type, and their convertibility depends on
+/// their value.
+static bool isTypeDeterminedArgument(const Expr& arg) {
+    if (!arg.hasType() || arg.isConstant()) return false;
+    return !arg.isArrayLiteralExpr() && !arg.isTupleExpr() && !arg.isIfExpr() && !arg.isUndefinedLiteralExpr() && !arg.isLambdaExpr();
+}
+
+static void appendToOverloadResolutionKey(llvm::SmallVectorImpl<const void*>& key, Type type) {
+    key.push_back(type.getBase());
+    key.push_back(reinterpret_cast<const void*>(uintptr_t(type.getMutability())));
+}
+
+Decl* Typechecker::resolveOverloadMemoized(llvm::ArrayRef<Decl*> decls, CallExpr& expr, llvm::StringRef callee, Type expectedType) {
+    bool isCacheable = !decls.empty() && llvm::none_of(decls, [](Decl* decl) {
+        // Interface methods are instantiated anew for each call.
+        return decl->isFunctionDecl() && llvm::cast<FunctionDecl>(decl)->getTypeDecl() && llvm::cast<FunctionDecl>(decl)->getTypeDecl()->isInterface();
+    });
+
+    if (isCacheable) {
+        isCacheable = llvm::all_of(expr.getArgs(), [](NamedValue& arg) { return arg.getValue()->hasType() || arg.getValue()->isVarExpr(); });
+    }
+
+    if (isCacheable) {
+        // Variable references are typed the same regardless of the parameter type, so typecheck them up front instead of once per candidate.
+        for (auto& arg : expr.getArgs()) {
+            if (!arg.getValue()->hasType()) typecheckExpr(*arg.getValue());
+        }
+        isCacheable = llvm::all_of(expr.getArgs(), [](NamedValue& arg) { return isTypeDeterminedArgument(*arg.getValue()); });
+    }
+
+    if (!isCacheable) {
+        uncachedOverloadResolutions++;
+        return resolveOverload(decls, expr, callee, expectedType);
+    }
+
+    llvm::SmallVector<const void*, 32> key;
+    key.push_back(currentModule);
+    key.insert(key.end(), decls.begin(), decls.end());
+    key.push_back(nullptr);
+    appendToOverloadResolutionKey(key, expectedType);
+    for (Type genericArg : expr.getGenericArgs()) {
+        appendToOverloadResolutionKey(key, genericArg);
+    }
+    key.push_back(nullptr);
+    for (auto& arg : expr.getArgs()) {
+        auto* value = arg.getValue();
+        key.push_back(Identifier(arg.getName()).getOpaqueValue());
+        appendToOverloadResolutionKey(key, value->getType());
+        auto valueCategory = uintptr_t(value->isLvalue()) | uintptr_t(value->isReferenceExpr()) << 1 | uintptr_t(value->isCallExpr()) << 2;
+        key.push_back(reinterpret_cast<const void*>(valueCategory));
+    }
+
+    auto it = overloadResolutionCache.find(key);
+    if (it != overloadResolutionCache.end()) {
+        overloadResolutionCacheHits++;
+        // Copy the entry, since validating the arguments may add entries to the cache.
+        auto cached = it->second;
+        validateAndConvertArguments(expr, *cached.decl, callee, expr.getCallee().getLocation());
+        declsToTypecheck.insert(declsToTypecheck.end(), cached.queuedDecls.begin(), cached.queuedDecls.end());
+        return cached.decl;
+    }
+
+    overloadResolutionCacheMisses++;
+    auto queuedDeclCount = declsToTypecheck.size();
+    auto* decl = resolveOverload(decls, expr, callee, expectedType);
+    auto* storedKey = overloadResolutionKeyAllocator.Allocate<const void*>(key.size());
+    std::copy(key.begin(), key.end(), storedKey);
+    auto queuedDecls = llvm::makeArrayRef(declsToTypecheck).drop_front(queuedDeclCount);
+    overloadResolutionCache.try_emplace(llvm::makeArrayRef(storedKey, key.size()),
+                                        CachedOverloadResolution { decl, llvm::SmallVector<Decl*, 2>(queuedDecls.begin(), queuedDecls.end()) });
+    return decl;
+}
+
 std::vector<Decl*> Typechecker::findCalleeCandidates(const CallExpr& expr, llvm::StringRef callee) {
     TypeDecl* receiverTypeDecl;
 
@@ -1119,9 +1195,10 @@ Type Typechecker::typecheckCallExpr(CallExpr& expr, Type expectedType) {
     }
 
     if (expr.getFunctionName() == "assert") {
-        ParamDecl assertParam(Type::getBool(), "", false, SourceLocation());
+        ParamDecl assertParam(Type::getBool(), Identifier(), false, SourceLocation());
         validateAndConvertArguments(expr, assertParam, false, expr.getFunctionName(), expr.getLocation());
         validateGenericArgCount(0, expr.getGenericArgs(), expr.getFunctionName(), expr.getLocation());
+        setStdlibFunctionsReferenced("assertFail");
         return Type::getVoid();
     }
 
@@ -1149,7 +1226,7 @@ Type Typechecker::typecheckCallExpr(CallExpr& expr, Type expectedType) {
             if (expr.getFunctionName() == "iterator") {
                 validateAndConvertArguments(expr, {}, false, expr.getFunctionName(), expr.getLocation());
                 validateGenericArgCount(0, expr.getGenericArgs(), expr.getFunctionName(), expr.getLocation());
-                return BasicType::get("ArrayIterator", receiverType.removePointer().getElementType());
+                return BasicType::get(Identifier("ArrayIterator"), receiverType.removePointer().getElementType());
             }
 
             ERROR(expr.getReceiver()->getLocation(), "type '" << receiverType.removePointer() << "' has no member function '" << expr.getFunctionName() << "'");
@@ -1175,16 +1252,16 @@ Type Typechecker::typecheckCallExpr(CallExpr& expr, Type expectedType) {
             return Type::getVoid();
         }
 
-        decl = resolveOverload(decls, expr, callee, expectedType);
+        decl = resolveOverloadMemoized(decls, expr, callee, expectedType);
     } else {
         auto callee = expr.getFunctionName();
         auto decls = findCalleeCandidates(expr, callee);
-        decl = resolveOverload(decls, expr, callee, expectedType);
+        decl = resolveOverloadMemoized(decls, expr, callee, expectedType);
 
         if (auto* constructorDecl = llvm::dyn_cast<ConstructorDecl>(decl)) {
             expr.setReceiverType(constructorDecl->getTypeDecl()->getType());
         } else if (decl->isMethodDecl()) {
-            auto* varDecl = llvm::cast<VarDecl>(findDecl("this", expr.getCallee().getLocation()));
+            auto* varDecl = llvm::cast<VarDecl>(findDecl(Identifier::find("this"), expr.getCallee().getLocation()));
             expr.setReceiverType(varDecl->getType());
         }
     }
@@ -1202,7 +1279,7 @@ Type Typechecker::typecheckCallExpr(CallExpr& expr, Type expectedType) {
         params = llvm::cast<FunctionType>(variableDecl->getType().getBase())->getParamDecls();
     } else {
         auto type = llvm::cast<EnumCase>(decl)->getAssociatedType();
-        params = map(type.getTupleElements(), [&](auto& e) { return ParamDecl(e.type, std::string(e.name), false, decl->getLocation()); });
+        params = map(type.getTupleElements(), [&](auto& e) { return ParamDecl(e.type, Identifier(e.name), false, decl->getLocation()); });
         validateAndConvertArguments(expr, params, false, decl->getName(), expr.getLocation());
     }
 
@@ -1213,7 +1290,11 @@ Type Typechecker::typecheckCallExpr(CallExpr& expr, Type expectedType) {
     }
 
     expr.setCalleeDecl(decl);
-    decl->setReferenced(true);
+    if (auto* functionDecl = llvm::dyn_cast<FunctionDecl>(decl)) {
+        setFunctionReferenced(*functionDecl);
+    } else {
+        decl->setReferenced(true);
+    }
 
     if (auto constructorDecl = llvm::dyn_cast<ConstructorDecl>(decl)) {
         if (constructorDecl->getTypeDecl()->isInterface()) {
@@ -1395,7 +1476,7 @@ static bool isValidCast(Type sourceType, Type targetType) {
 Type Typechecker::typecheckBuiltinCast(CallExpr& expr) {
     Type sourceType = typecheckExpr(*expr.getArgs().front().getValue());
     Type targetType = expr.getGenericArgs().front();
-    ParamDecl param(sourceType, "", false, expr.getLocation());
+    ParamDecl param(sourceType, Identifier(), false, expr.getLocation());
 
     validateGenericArgCount(1, expr.getGenericArgs(), expr.getFunctionName(), expr.getLocation());
     validateAndConvertArguments(expr, param, false, expr.getFunctionName(), expr.getLocation());
@@ -1519,6 +1600,7 @@ Type Typechecker::typecheckUnwrapExpr(UnwrapExpr& expr) {
     if (!type.isOptionalType()) {
         ERROR(expr.getLocation(), "cannot unwrap non-optional type '" << type << "'");
     }
+    setStdlibFunctionsReferenced("assertFail");
     return type.getWrappedType();
 }
 
@@ -1565,6 +1647,8 @@ Type Typechecker::typecheckExpr(Expr& expr, bool useIsWriteOnly, Type expectedTy
             break;
         case ExprKind::StringLiteralExpr:
             type = typecheckStringLiteralExpr(llvm::cast<StringLiteralExpr>(expr));
+            // String literals converted to 'string' are constructed by calling string(char* pointer, int length).
+            setStdlibFunctionsReferenced("string.init");
             break;
         case ExprKind::CharacterLiteralExpr:
             type = typecheckCharacterLiteralExpr(llvm::cast<CharacterLiteralExpr>(expr));
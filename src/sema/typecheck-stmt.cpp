@@ -225,6 +225,8 @@ bool Typechecker::typecheckStmt(Stmt*& stmt) {
             case StmtKind::CompoundStmt:
                 typecheckCompoundStmt(llvm::cast<CompoundStmt>(*stmt));
                 break;
+            case StmtKind::ErrorStmt:
+                break;
         }
     } catch (const CompileError& error) {
         error.print();
@@ -2,12 +2,15 @@
 #pragma warning(push, 0)
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Path.h>
+#include <llvm/Support/FormatVariadic.h>
 #include <llvm/Support/SaveAndRestore.h>
 #pragma warning(pop)
 #include "../ast/module.h"
 #include "../driver/driver.h"
 #include "../package-manager/manifest.h"
 #include "../parser/parse.h"
+#include "../support/statistics.h"
+#include "../support/time-report.h"
 
 using namespace cx;
 
@@ -32,6 +35,11 @@ TypeDecl* Typechecker::getTypeDecl(const BasicType& type) {
     return instantiation;
 }
 
+static void parseModuleSources(llvm::ArrayRef<std::string> paths, Module& module, const CompileOptions& options) {
+    PhaseTimer timer("Parsing", module.getName());
+    parseSourceFiles(paths, module, options, options.lazyFunctionBodies);
+}
+
 static std::error_code importModuleSourcesInDirectoryRecursively(const llvm::Twine& directoryPath, Module& module, const CompileOptions& options) {
     std::error_code error;
     std::vector<std::string> paths;
@@ -45,11 +53,7 @@ static std::error_code importModuleSourcesInDirectoryRecursively(const llvm::Twi
 
     if (!error) {
         llvm::sort(paths);
-
-        for (auto& path : paths) {
-            Parser parser(path, module, options);
-            parser.parse();
-        }
+        parseModuleSources(paths, module, options);
     }
 
     if (module.getSourceFiles().empty()) {
@@ -136,6 +140,7 @@ static void checkUnusedDecls(const Module& module) {
 }
 
 void Typechecker::typecheckModule(Module& module, const PackageManifest* manifest) {
+    PhaseTimer timer("Typechecking", module.getName());
     auto stdModule = importModule(nullptr, nullptr, "std");
     if (!stdModule) {
         ABORT("couldn't import the standard library: " << stdModule.getError().message());
@@ -148,7 +153,7 @@ void Typechecker::typecheckModule(Module& module, const PackageManifest* manifes
             currentSourceFile = &sourceFile;
 
             if (auto typeDecl = llvm::dyn_cast<TypeDecl>(decl)) {
-                llvm::StringMap<Type> genericArgs = { { "This", typeDecl->getType() } };
+                llvm::DenseMap<Identifier, Type> genericArgs = { { Identifier("This"), typeDecl->getType() } };
 
                 for (Type interface : typeDecl->getInterfaces()) {
                     typecheckType(interface, typeDecl->getAccessLevel());
@@ -216,11 +221,19 @@ void Typechecker::typecheckModule(Module& module, const PackageManifest* manifes
     currentSourceFile = nullptr;
 }
 
+void Typechecker::addStatistics() const {
+    auto lookups = overloadResolutionCacheHits + overloadResolutionCacheMisses;
+    auto hitRate = lookups ? 100.0 * overloadResolutionCacheHits / lookups : 0.0;
+    addStatistic("overload resolution cache", llvm::Twine(overloadResolutionCacheHits) + " hits, " + llvm::Twine(overloadResolutionCacheMisses) +
+                                                  " misses, " + llvm::Twine(uncachedOverloadResolutions) + " uncached (" +
+                                                  llvm::formatv("{0:F1}", hitRate).str() + "% hit rate)");
+}
+
 bool Typechecker::isWarningEnabled(llvm::StringRef warning) const {
     return !llvm::is_contained(options.disabledWarnings, warning);
 }
 
-static llvm::SmallVector<Decl*, 1> findDeclsInModules(llvm::StringRef name, llvm::ArrayRef<Module*> modules) {
+static llvm::SmallVector<Decl*, 1> findDeclsInModules(Identifier name, llvm::ArrayRef<Module*> modules) {
     llvm::SmallVector<Decl*, 1> decls;
 
     for (auto& module : modules) {
@@ -231,7 +244,7 @@ static llvm::SmallVector<Decl*, 1> findDeclsInModules(llvm::StringRef name, llvm
     return decls;
 }
 
-static Decl* findDeclInModules(llvm::StringRef name, SourceLocation location, llvm::ArrayRef<Module*> modules) {
+static Decl* findDeclInModules(Identifier name, SourceLocation location, llvm::ArrayRef<Module*> modules) {
     auto decls = findDeclsInModules(name, modules);
 
     if (decls.size() == 1) {
@@ -246,7 +259,7 @@ static Decl* findDeclInModules(llvm::StringRef name, SourceLocation location, ll
     }
 }
 
-Decl* Typechecker::findDecl(llvm::StringRef name, SourceLocation location) const {
+Decl* Typechecker::findDecl(Identifier name, SourceLocation location) const {
     ASSERT(!name.empty());
 
     if (Decl* match = findDeclInModules(name, location, currentModule)) {
@@ -289,7 +302,7 @@ static void append(std::vector<Decl*>& target, llvm::ArrayRef<Decl*> source) {
     }
 }
 
-std::vector<Decl*> Typechecker::findDecls(llvm::StringRef name, TypeDecl* receiverTypeDecl, bool inAllImportedModules) const {
+std::vector<Decl*> Typechecker::findDecls(Identifier name, TypeDecl* receiverTypeDecl, bool inAllImportedModules) const {
     std::vector<Decl*> decls;
 
     if (!receiverTypeDecl && currentFunction) {
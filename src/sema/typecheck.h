@@ -4,8 +4,12 @@
 #include <string>
 #include <vector>
 #pragma warning(push, 0)
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Allocator.h>
 #include <llvm/Support/ErrorOr.h>
 #pragma warning(pop)
 #include "../ast/decl.h"
@@ -50,11 +54,22 @@ struct Match {
     bool didConvertArguments;
 };
 
+/// The outcome of an overload resolution, memoized for calls whose arguments are all typechecked independently of the parameter types.
+struct CachedOverloadResolution {
+    Decl* decl;
+    /// The decls the resolution queued to be typechecked, such as the template instantiations it created. They're queued again on a
+    /// cache hit.
+    llvm::SmallVector<Decl*, 2> queuedDecls;
+};
+
 struct Typechecker {
     Typechecker(const CompileOptions& options)
     : currentModule(nullptr), currentSourceFile(nullptr), currentFunction(nullptr), currentStmt(nullptr), currentInitializedFields(nullptr),
       isPostProcessing(false), options(options) {}
     void typecheckModule(Module& module, const PackageManifest* manifest);
+    llvm::ErrorOr<const Module&> importModule(SourceFile* importer, const PackageManifest* manifest, llvm::StringRef moduleName);
+    /// Records the hit rate of the overload resolution cache for -print-stats.
+    void addStatistics() const;
 
 private:
     Module* getCurrentModule() const { return NOTNULL(currentModule); }
@@ -64,6 +79,11 @@ private:
     void typecheckTopLevelDecl(Decl& decl, const PackageManifest* manifest);
     void typecheckParams(llvm::MutableArrayRef<ParamDecl> params, AccessLevel userAccessLevel);
     void typecheckFunctionDecl(FunctionDecl& decl);
+    /// Marks the function as referenced, queueing its body to be parsed and typechecked if the parser skipped it.
+    void setFunctionReferenced(FunctionDecl& decl);
+    /// Marks the standard library functions with the given name as referenced, for expressions that IR generation implements by
+    /// calling them without a reference in the AST, e.g. assert() calling assertFail.
+    void setStdlibFunctionsReferenced(llvm::StringRef name);
     void typecheckFunctionTemplate(FunctionTemplate& decl);
     void typecheckMethodDecl(Decl& decl);
 
@@ -112,12 +132,18 @@ private:
                                  llvm::Optional<ImplicitCastExpr::Kind>* implicitCastKind = nullptr) const;
     void typecheckImplicitlyBoolConvertibleExpr(Type type, SourceLocation location, bool positive = true);
     Type findGenericArg(Type argType, Type paramType, llvm::StringRef genericParam);
-    llvm::StringMap<Type> getGenericArgsForCall(llvm::ArrayRef<GenericParamDecl> genericParams, CallExpr& call, FunctionDecl* decl, bool returnOnError,
-                                                Type expectedType);
-    Decl* findDecl(llvm::StringRef name, SourceLocation location) const;
-    std::vector<Decl*> findDecls(llvm::StringRef name, TypeDecl* receiverTypeDecl = nullptr, bool inAllImportedModules = false) const;
+    llvm::DenseMap<Identifier, Type> getGenericArgsForCall(llvm::ArrayRef<GenericParamDecl> genericParams, CallExpr& call, FunctionDecl* decl,
+                                                           bool returnOnError, Type expectedType);
+    Decl* findDecl(Identifier name, SourceLocation location) const;
+    std::vector<Decl*> findDecls(Identifier name, TypeDecl* receiverTypeDecl = nullptr, bool inAllImportedModules = false) const;
+    /// Looks up a name given as a string without interning it.
+    std::vector<Decl*> findDecls(llvm::StringRef name, TypeDecl* receiverTypeDecl = nullptr, bool inAllImportedModules = false) const {
+        return findDecls(Identifier::find(name), receiverTypeDecl, inAllImportedModules);
+    }
     std::vector<Decl*> findCalleeCandidates(const CallExpr& expr, llvm::StringRef callee);
     Decl* resolveOverload(llvm::ArrayRef<Decl*> decls, CallExpr& expr, llvm::StringRef callee, Type expectedType);
+    /// Like resolveOverload, but reuses the result of an earlier resolution of the same candidates with the same argument types.
+    Decl* resolveOverloadMemoized(llvm::ArrayRef<Decl*> decls, CallExpr& expr, llvm::StringRef callee, Type expectedType);
     std::vector<Type> inferGenericArgsFromCallArgs(llvm::ArrayRef<GenericParamDecl> genericParams, CallExpr& call, llvm::ArrayRef<ParamDecl> params,
                                                    bool returnOnError);
     ArgumentValidation getArgumentValidationResult(CallExpr& expr, llvm::ArrayRef<ParamDecl> params, bool isVariadic);
@@ -130,7 +156,6 @@ private:
     void checkReturnPointerToLocal(const Expr* returnValue) const;
     static void checkHasAccess(const Decl& decl, SourceLocation location, AccessLevel userAccessLevel);
     void checkLambdaCapture(const VariableDecl& variableDecl, const VarExpr& varExpr) const;
-    llvm::ErrorOr<const Module&> importModule(SourceFile* importer, const PackageManifest* manifest, llvm::StringRef moduleName);
     void postProcess();
 
     void setMoved(Expr* expr, bool isMoved);
@@ -148,6 +173,14 @@ private:
     llvm::SmallPtrSet<Decl*, 32> movedDecls;
     bool isPostProcessing;
     std::vector<Decl*> declsToTypecheck;
+    /// Keyed on the current module, the candidate decls, the expected type, the explicit generic arguments, and the name, type, and
+    /// value category of each argument. Since the candidates are part of the key, a decl entering scope invalidates the entries it affects.
+    /// The keys are stored in overloadResolutionKeyAllocator, so that looking up an entry doesn't allocate.
+    llvm::DenseMap<llvm::ArrayRef<const void*>, CachedOverloadResolution> overloadResolutionCache;
+    llvm::BumpPtrAllocator overloadResolutionKeyAllocator;
+    unsigned overloadResolutionCacheHits = 0;
+    unsigned overloadResolutionCacheMisses = 0;
+    unsigned uncachedOverloadResolutions = 0;
     const CompileOptions& options;
 };
 
@@ -0,0 +1,14 @@
+#include "arena.h"
+#pragma warning(push, 0)
+#include <llvm/ADT/STLExtras.h>
+#pragma warning(pop)
+
+using namespace cx;
+
+void Arena::reset() {
+    for (auto& entry : llvm::reverse(destructors)) {
+        entry.destructor(entry.object);
+    }
+    destructors.clear();
+    allocator.Reset();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#pragma warning(push, 0)
+#include <llvm/Support/Allocator.h>
+#pragma warning(pop)
+
+namespace cx {
+
+/// Allocates objects by bumping a pointer through large slabs of memory, and releases all of them at once when the arena is
+/// reset or destroyed. The destructors of objects that need them are run in reverse order of allocation before the memory is freed.
+/// Objects allocated from an arena must not be deleted individually.
+struct Arena {
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena() { reset(); }
+
+    void* allocate(size_t size, size_t alignment) { return allocator.Allocate(size, llvm::Align(alignment)); }
+
+    /// Allocates and constructs an object of type T. Aggregates are initialized with braces, other types with parentheses.
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* object;
+        if constexpr (std::is_aggregate_v<T>) {
+            object = new (memory) T { std::forward<Args>(args)... };
+        } else {
+            object = new (memory) T(std::forward<Args>(args)...);
+        }
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destructors.push_back({ object, [](void* object) { static_cast<T*>(object)->~T(); } });
+        }
+        return object;
+    }
+
+    /// Destroys all objects allocated from the arena and frees its memory, except for the first slab which is kept for reuse.
+    void reset();
+
+private:
+    struct DestructorEntry {
+        void* object;
+        void (*destructor)(void*);
+    };
+
+    llvm::BumpPtrAllocator allocator;
+    std::vector<DestructorEntry> destructors;
+};
+
+} // namespace cx
@@ -0,0 +1,49 @@
+#include "statistics.h"
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#pragma warning(push, 0)
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/raw_ostream.h>
+#pragma warning(pop)
+
+using namespace cx;
+
+static bool statisticsEnabled = false;
+static std::mutex statisticsMutex;
+static std::vector<std::pair<std::string, std::vector<std::string>>> statistics;
+
+void cx::enableStatistics() {
+    statisticsEnabled = true;
+}
+
+bool cx::areStatisticsEnabled() {
+    return statisticsEnabled;
+}
+
+void cx::addStatistic(llvm::StringRef component, const llvm::Twine& line) {
+    if (!statisticsEnabled) return;
+
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    auto it = llvm::find_if(statistics, [&](auto& componentStatistics) { return componentStatistics.first == component; });
+    if (it == statistics.end()) it = statistics.insert(it, { component.str(), {} });
+    it->second.push_back(line.str());
+}
+
+void cx::printStatistics(llvm::raw_ostream& stream) {
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    if (statistics.empty()) return;
+
+    stream << "===-------------------------------------------------------------------------===\n";
+    stream << "                          C* compiler statistics\n";
+    stream << "===-------------------------------------------------------------------------===\n";
+
+    for (auto& componentStatistics : statistics) {
+        for (auto& line : componentStatistics.second) {
+            stream << componentStatistics.first << ": " << line << '\n';
+        }
+    }
+
+    statistics.clear();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#pragma warning(push, 0)
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/Twine.h>
+#pragma warning(pop)
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace cx {
+
+/// Makes addStatistic() record statistics, which it ignores otherwise. Enabled by -print-stats.
+void enableStatistics();
+bool areStatisticsEnabled();
+/// Records a line of statistics about the given component of the compiler, e.g. a cache's hit rate or one of its hits or
+/// misses. Thread-safe.
+void addStatistic(llvm::StringRef component, const llvm::Twine& line);
+/// Prints the statistics recorded since the last call, grouped by component in the order in which the components first
+/// recorded statistics. Prints nothing if no statistics have been recorded.
+void printStatistics(llvm::raw_ostream& stream);
+
+} // namespace cx
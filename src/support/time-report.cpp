@@ -0,0 +1,202 @@
+#include "time-report.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#pragma warning(push, 0)
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/raw_ostream.h>
+#pragma warning(pop)
+#include "utility.h"
+
+using namespace cx;
+
+// Heap allocations are counted per thread by replacing the global allocation functions, so that counting doesn't introduce
+// contention between the code generation threads. The array and nothrow forms forward to these by default.
+
+static thread_local uint64_t allocationCount = 0;
+static thread_local uint64_t allocatedBytes = 0;
+
+void* operator new(std::size_t size) {
+    ++allocationCount;
+    allocatedBytes += size;
+    if (size == 0) size = 1;
+
+    while (true) {
+        if (void* pointer = std::malloc(size)) return pointer;
+        auto newHandler = std::get_new_handler();
+        if (!newHandler) throw std::bad_alloc();
+        newHandler();
+    }
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+
+struct PhaseRecord {
+    std::string phase;
+    std::string detail;
+    int64_t startMicroseconds;
+    int64_t durationMicroseconds;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    uint64_t peakResidentSetSize;
+    unsigned depth;
+    unsigned threadIndex;
+};
+
+} // namespace
+
+static bool phaseTimingEnabled = false;
+static std::chrono::steady_clock::time_point startTime;
+static std::mutex phaseRecordsMutex;
+static std::vector<PhaseRecord> phaseRecords;
+static llvm::DenseMap<uint64_t, unsigned> threadIndices;
+static thread_local unsigned phaseDepth = 0;
+
+static int64_t getElapsedMicroseconds() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+/// Returns the peak resident set size of the process in bytes, or 0 if it can't be determined.
+static uint64_t getPeakResidentSetSize() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+PhaseTimer::PhaseTimer(llvm::StringRef phase, llvm::StringRef detail) : enabled(phaseTimingEnabled) {
+    if (!enabled) return;
+    this->phase = phase.str();
+    this->detail = detail.str();
+    startAllocations = allocationCount;
+    startAllocatedBytes = allocatedBytes;
+    startMicroseconds = getElapsedMicroseconds();
+    ++phaseDepth;
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (!enabled) return;
+    auto endMicroseconds = getElapsedMicroseconds();
+    --phaseDepth;
+
+    std::lock_guard<std::mutex> lock(phaseRecordsMutex);
+    auto threadIndex = threadIndices.try_emplace(llvm::get_threadid(), threadIndices.size()).first->second;
+    phaseRecords.push_back({ std::move(phase), std::move(detail), startMicroseconds, endMicroseconds - startMicroseconds,
+                             allocationCount - startAllocations, allocatedBytes - startAllocatedBytes, getPeakResidentSetSize(), phaseDepth,
+                             threadIndex });
+}
+
+void cx::enablePhaseTiming() {
+    phaseTimingEnabled = true;
+    startTime = std::chrono::steady_clock::now();
+    threadIndices.try_emplace(llvm::get_threadid(), 0);
+}
+
+static std::vector<PhaseRecord> getSortedPhaseRecords() {
+    std::lock_guard<std::mutex> lock(phaseRecordsMutex);
+    auto records = phaseRecords;
+    std::stable_sort(records.begin(), records.end(), [](const PhaseRecord& a, const PhaseRecord& b) {
+        if (a.threadIndex != b.threadIndex) return a.threadIndex < b.threadIndex;
+        if (a.startMicroseconds != b.startMicroseconds) return a.startMicroseconds < b.startMicroseconds;
+        return a.depth < b.depth;
+    });
+    return records;
+}
+
+void cx::printTimeReport(llvm::raw_ostream& stream) {
+    auto records = getSortedPhaseRecords();
+    unsigned currentThreadIndex = 0;
+
+    stream << "===-------------------------------------------------------------------------===\n";
+    stream << "                          C* compiler phase report\n";
+    stream << "===-------------------------------------------------------------------------===\n";
+    stream << "  Time (ms)  Allocations  Allocated (KB)  Peak RSS (MB)  Phase\n";
+
+    for (auto& record : records) {
+        if (record.threadIndex != currentThreadIndex) {
+            currentThreadIndex = record.threadIndex;
+            stream << "  --- thread " << currentThreadIndex << " ---\n";
+        }
+
+        stream << llvm::format("%11.3f  %11llu  %14.1f  %13.1f  ", record.durationMicroseconds / 1e3, (unsigned long long) record.allocations,
+                               record.allocatedBytes / 1024.0, record.peakResidentSetSize / (1024.0 * 1024.0));
+        stream.indent(record.depth * 2) << record.phase;
+        if (!record.detail.empty()) stream << " (" << record.detail << ")";
+        stream << '\n';
+    }
+
+    stream << llvm::format("%11.3f", getElapsedMicroseconds() / 1e3);
+    stream.indent(31) << llvm::format("%13.1f  ", getPeakResidentSetSize() / (1024.0 * 1024.0)) << "Total\n";
+}
+
+void cx::writeTimeTrace(llvm::StringRef path) {
+    auto records = getSortedPhaseRecords();
+
+    std::error_code error;
+    llvm::raw_fd_ostream file(path, error, llvm::sys::fs::OF_Text);
+    if (error) ABORT("couldn't write time trace file '" << path << "': " << error.message());
+
+    llvm::json::OStream json(file);
+    json.object([&] {
+        json.attributeArray("traceEvents", [&] {
+            for (auto& record : records) {
+                json.object([&] {
+                    json.attribute("name", record.phase);
+                    json.attribute("cat", "cx");
+                    json.attribute("ph", "X");
+                    json.attribute("pid", 1);
+                    json.attribute("tid", int64_t(record.threadIndex));
+                    json.attribute("ts", record.startMicroseconds);
+                    json.attribute("dur", record.durationMicroseconds);
+                    json.attributeObject("args", [&] {
+                        if (!record.detail.empty()) json.attribute("detail", record.detail);
+                        json.attribute("allocations", int64_t(record.allocations));
+                        json.attribute("allocatedBytes", int64_t(record.allocatedBytes));
+                        json.attribute("peakResidentSetSize", int64_t(record.peakResidentSetSize));
+                    });
+                });
+            }
+
+            json.object([&] {
+                json.attribute("name", "process_name");
+                json.attribute("ph", "M");
+                json.attribute("pid", 1);
+                json.attributeObject("args", [&] { json.attribute("name", "cx"); });
+            });
+        });
+        json.attribute("displayTimeUnit", "ms");
+    });
+    file << '\n';
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#pragma warning(push, 0)
+#include <llvm/ADT/StringRef.h>
+#pragma warning(pop)
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace cx {
+
+/// Measures the compiler phase that runs during its lifetime: wall-clock time, the number and total size of heap allocations
+/// made by the current thread, and the peak resident set size of the process when the phase ends. Phases can be nested.
+/// Nothing is recorded unless enablePhaseTiming() has been called.
+struct PhaseTimer {
+    /// The detail is typically the name of the module or file that the phase processes.
+    PhaseTimer(llvm::StringRef phase, llvm::StringRef detail = "");
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    std::string phase;
+    std::string detail;
+    int64_t startMicroseconds;
+    uint64_t startAllocations;
+    uint64_t startAllocatedBytes;
+    bool enabled;
+};
+
+void enablePhaseTiming();
+/// Prints the recorded phases in the order in which they started, indented by nesting depth.
+void printTimeReport(llvm::raw_ostream& stream);
+/// Writes the recorded phases as a Chrome trace event file, viewable in chrome://tracing or https://ui.perfetto.dev.
+void writeTimeTrace(llvm::StringRef path);
+
+} // namespace cx
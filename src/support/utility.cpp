@@ -1,6 +1,6 @@
 #include "utility.h"
 #include <algorithm>
-#include <fstream>
+#include <atomic>
 #include <ostream>
 #pragma warning(push, 0)
 #include <llvm/Support/CommandLine.h>
@@ -10,29 +10,20 @@
 #include <llvm/Support/Program.h>
 #include <llvm/Support/Signals.h>
 #pragma warning(pop)
+#include "../ast/source-manager.h"
 
 using namespace cx;
 
 namespace cx {
-extern int errors;
+extern std::atomic<int> errors;
 }
 
+static thread_local DiagnosticBuffer* currentDiagnosticBuffer = nullptr;
+
 std::ostream& cx::operator<<(std::ostream& stream, llvm::StringRef string) {
     return stream.write(string.data(), string.size());
 }
 
-std::string cx::readLineFromFile(SourceLocation location) {
-    std::ifstream file(location.file);
-
-    while (--location.line) {
-        file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    }
-
-    std::string lineContent;
-    std::getline(file, lineContent);
-    return lineContent;
-}
-
 void cx::renameFile(llvm::Twine sourcePath, llvm::Twine targetPath) {
     auto permissions = llvm::sys::fs::getPermissions(sourcePath);
     if (auto error = permissions.getError()) {
@@ -50,6 +41,11 @@ void cx::renameFile(llvm::Twine sourcePath, llvm::Twine targetPath) {
 }
 
 void cx::printDiagnostic(SourceLocation location, llvm::StringRef type, llvm::raw_ostream::Colors color, llvm::StringRef message) {
+    if (currentDiagnosticBuffer) {
+        currentDiagnosticBuffer->diagnostics.push_back({ location, type.str(), color, message.str(), false });
+        return;
+    }
+
     if (llvm::outs().has_colors()) {
         llvm::outs().changeColor(llvm::raw_ostream::SAVEDCOLOR, true);
     }
@@ -62,11 +58,12 @@ void cx::printDiagnostic(SourceLocation location, llvm::StringRef type, llvm::ra
     printColored(": ", color);
     printColored(message, llvm::raw_ostream::SAVEDCOLOR);
 
-    if (location.file && *location.file && location.isValid()) {
-        auto line = readLineFromFile(location);
+    if (location.isValid()) {
+        auto decodedLocation = location.decode();
+        auto line = SourceManager::get().getLineContents(decodedLocation.file, decodedLocation.line);
         llvm::outs() << '\n' << line << '\n';
 
-        for (char ch : line.substr(0, location.column - 1)) {
+        for (char ch : line.substr(0, decodedLocation.column - 1)) {
             llvm::outs() << (ch != '\t' ? ' ' : '\t');
         }
         printColored('^', llvm::raw_ostream::GREEN);
@@ -75,6 +72,25 @@ void cx::printDiagnostic(SourceLocation location, llvm::StringRef type, llvm::ra
     llvm::outs() << '\n';
 }
 
+void DiagnosticBuffer::flush() {
+    ASSERT(currentDiagnosticBuffer != this);
+
+    for (auto& diagnostic : diagnostics) {
+        if (diagnostic.isError) errors++;
+        printDiagnostic(diagnostic.location, diagnostic.type, diagnostic.color, diagnostic.message);
+    }
+
+    diagnostics.clear();
+}
+
+DiagnosticBufferScope::DiagnosticBufferScope(DiagnosticBuffer& buffer) : previousBuffer(currentDiagnosticBuffer) {
+    currentDiagnosticBuffer = &buffer;
+}
+
+DiagnosticBufferScope::~DiagnosticBufferScope() {
+    currentDiagnosticBuffer = previousBuffer;
+}
+
 CompileError::CompileError() = default;
 
 CompileError::CompileError(SourceLocation location, std::string&& message, std::vector<Note>&& notes)
@@ -117,8 +133,13 @@ void cx::abort(StringFormatter& message) {
 }
 
 void cx::reportError(SourceLocation location, StringFormatter& message, llvm::ArrayRef<Note> notes) {
-    errors++;
-    printDiagnostic(location, "error", llvm::raw_ostream::RED, message.str());
+    if (currentDiagnosticBuffer) {
+        // The error is counted when the buffer is flushed, so that worker threads never modify the error count.
+        currentDiagnosticBuffer->diagnostics.push_back({ location, "error", llvm::raw_ostream::RED, message.str(), true });
+    } else {
+        errors++;
+        printDiagnostic(location, "error", llvm::raw_ostream::RED, message.str());
+    }
 
     for (auto& note : notes) {
         printDiagnostic(note.location, "note", llvm::raw_ostream::BLACK, note.message);
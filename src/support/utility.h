@@ -53,7 +53,6 @@ private:
     std::string message;
 };
 
-std::string readLineFromFile(SourceLocation location);
 void renameFile(llvm::Twine sourcePath, llvm::Twine targetPath);
 void printDiagnostic(SourceLocation location, llvm::StringRef type, llvm::raw_ostream::Colors color, llvm::StringRef message);
 
@@ -80,6 +79,35 @@ void printColored(const T& text, llvm::raw_ostream::Colors color) {
     if (llvm::outs().has_colors()) llvm::outs().resetColor();
 }
 
+/// Collects diagnostics instead of printing them, so that diagnostics reported by concurrent jobs can be printed in a
+/// deterministic order. Diagnostics reported on a thread are collected while a DiagnosticBufferScope is active on it.
+struct DiagnosticBuffer {
+    /// Prints the collected diagnostics in the order they were reported and counts the errors among them.
+    void flush();
+
+private:
+    friend void printDiagnostic(SourceLocation, llvm::StringRef, llvm::raw_ostream::Colors, llvm::StringRef);
+    friend void reportError(SourceLocation, StringFormatter&, llvm::ArrayRef<Note>);
+
+    struct Diagnostic {
+        SourceLocation location;
+        std::string type;
+        llvm::raw_ostream::Colors color;
+        std::string message;
+        bool isError;
+    };
+
+    std::vector<Diagnostic> diagnostics;
+};
+
+struct DiagnosticBufferScope {
+    explicit DiagnosticBufferScope(DiagnosticBuffer& buffer);
+    ~DiagnosticBufferScope();
+
+private:
+    DiagnosticBuffer* previousBuffer;
+};
+
 void printStackTrace();
 [[noreturn]] void abort(StringFormatter& message);
 void reportError(SourceLocation location, StringFormatter& message, llvm::ArrayRef<Note> notes = {});
@@ -0,0 +1 @@
+enum { INCLUDE_PATH_HEADER_VALUE = 42 };
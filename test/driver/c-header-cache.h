@@ -0,0 +1,12 @@
+#define VALUE 3
+#define HALF 0.5
+#define ALIAS value
+
+typedef int value;
+
+enum Color { Red, Green, Blue };
+
+struct Pair {
+    value a;
+    value b;
+};